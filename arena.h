@@ -0,0 +1,83 @@
+/**	@file	arena.h
+ *
+ * A bump pointer arena allocator
+ *
+ * @author Randy Merkel, Slowly but Surly Software.
+ * @copyright  (c) 2017 Slowly but Surly Software. All rights reserved.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/** A bump pointer arena
+ *
+ * Objects are carved, in order, out of blockSize character blocks, or a block of their own if
+ * they're larger; allocation is just a pointer increment. Objects are never destroyed, so they
+ * must be trivially destructible; clear() frees the whole arena at once.
+ */
+class Arena {
+public:
+	static const std::size_t blockSize = 64 * 1024;	///< Block size, in characters
+
+	Arena() : next{nullptr}, left{0} {}		///< Constructor
+
+	/// Construct a T from args in the arena
+	template <typename T, typename... Args>
+	T* make(Args&&... args) {
+		static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+		return new (alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	/// Allocate an array of n value initialized Ts in the arena
+	template <typename T>
+	T* array(std::size_t n) {
+		static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+		T* p = static_cast<T*>(alloc(n * sizeof(T), alignof(T)));
+		std::uninitialized_value_construct_n(p, n);
+		return p;
+	}
+
+	/// Free everything allocated from the arena
+	void clear() {
+		blocks.clear();
+		next = nullptr;
+		left = 0;
+	}
+
+private:
+	std::vector<std::unique_ptr<char[]>> blocks;	///< The arena
+	char*				next;					///< The next free character in the last block
+	std::size_t			left;					///< Characters left in the last block
+
+	/**
+	 * @param	size	Size of the allocation, in characters
+	 * @param	align	It's alignment, a power of two
+	 * @return	The allocation
+	 */
+	void* alloc(std::size_t size, std::size_t align) {
+		const std::size_t pad = (align - reinterpret_cast<std::uintptr_t>(next) % align) % align;
+		if (pad + size > left) {
+			const auto n = std::max(size + align, static_cast<std::size_t>(blockSize));
+			blocks.emplace_back(new char[n]);
+			next = blocks.back().get();
+			left = n;
+			return alloc(size, align);
+		}
+
+		void* p = next + pad;
+		next += pad + size;
+		left -= pad + size;
+		return p;
+	}
+};
+
+#endif
@@ -0,0 +1,368 @@
+/** @file ast.cc
+ *
+ * The PL/0C abstract syntax tree, and it's code generator
+ *
+ * @author Randy Merkel, Slowly but Surly Software.
+ * @copyright  (c) 2017 Slowly but Surly Software. All rights reserved.
+ */
+
+#include "ast.h"
+#include "comp.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/************************************************************************************************
+ *	Nodes
+ ************************************************************************************************/
+
+void InvalidNode::accept(Visitor& v)		{	v.visit(*this);	}
+void ConstNode::accept(Visitor& v)			{	v.visit(*this);	}
+void VarNode::accept(Visitor& v)			{	v.visit(*this);	}
+void CallNode::accept(Visitor& v)			{	v.visit(*this);	}
+void UnaryNode::accept(Visitor& v)			{	v.visit(*this);	}
+void BinaryNode::accept(Visitor& v)			{	v.visit(*this);	}
+void LogicalNode::accept(Visitor& v)		{	v.visit(*this);	}
+
+void CompoundNode::accept(Visitor& v)		{	v.visit(*this);	}
+void AssignNode::accept(Visitor& v)			{	v.visit(*this);	}
+void CallStmtNode::accept(Visitor& v)		{	v.visit(*this);	}
+void WhileNode::accept(Visitor& v)			{	v.visit(*this);	}
+void IfNode::accept(Visitor& v)				{	v.visit(*this);	}
+void RepeatNode::accept(Visitor& v)			{	v.visit(*this);	}
+void ForNode::accept(Visitor& v)			{	v.visit(*this);	}
+void CaseNode::accept(Visitor& v)			{	v.visit(*this);	}
+
+void BlockNode::accept(Visitor& v)			{	v.visit(*this);	}
+
+/************************************************************************************************
+ *	class CodeGen
+ *
+ * Generates code from the nodes built by Comp's productions; a block at a time as each is parsed,
+ * or the whole program once it's been parsed.
+ ************************************************************************************************/
+
+// public
+
+/**
+ * Emits a call to main, followed by a halt, ahead of the blocks.
+ *
+ * @param	callLine	Source line of the call to main
+ */
+void CodeGen::prologue(size_t callLine) {
+	line = callLine;
+	call_pc = comp.emit(OpCode::Call, 0, 0);
+	comp.emit(OpCode::Halt);
+}
+
+/// @param	main	The outer block, which has been generated
+void CodeGen::epilogue(BlockNode& main) {
+	if (comp.verbose)
+		cout << comp.progName << ": patching call to main at " << call_pc << " to " << main.entry.uinteger() << "\n";
+
+	(*comp.code)[call_pc].addr = main.entry.uinteger();
+}
+
+/**
+ * Adds the block's subroutine, ahead of those of any nested blocks.
+ *
+ * @param	n	The block
+ */
+void CodeGen::enter(BlockNode& n) {
+	const auto parent = comp.cursubr;
+	comp.cursubr = comp.subrs.size();
+	comp.subrs.push_back({	n.name, 0, 0, n.level, parent,
+							static_cast<unsigned>(n.nParams),
+							n.function	});
+}
+
+/**
+ * Emits the block's statements, after those of any nested blocks, and then returns to the
+ * enclosing block's subroutine.
+ *
+ * @param	n	The block
+ */
+void CodeGen::leave(BlockNode& n) {
+	line = n.enterLine;
+	const auto addr = n.locals > 0 ? comp.emit(OpCode::Enter, 0, n.locals) : comp.code->size();
+	n.entry = addr;
+
+	statements(n.body);
+
+	line = n.exitLine;
+	const auto exit = comp.emit(n.function ? OpCode::Retf : OpCode::Ret, 0, n.nParams);
+
+	auto& subr = comp.subrs[comp.cursubr];
+	subr.entry = addr;
+	subr.exit = exit;
+	comp.cursubr = subr.parent;
+}
+
+/// @param	n	The node to generate
+void CodeGen::visit(InvalidNode&) {}
+
+/// @param	n	The node to generate
+void CodeGen::visit(ConstNode& n) {
+	line = n.line;
+	comp.emit(OpCode::Push, 0, n.value);
+}
+
+/// @param	n	The node to generate
+void CodeGen::visit(VarNode& n) {
+	line = n.line;
+	comp.emitVarRef(n.depth, n.offset);
+	comp.emit(OpCode::Eval);
+}
+
+/**
+ * Callees that haven't been generated yet, e.g., an enclosing subroutine, are called at their
+ * entry point so far.
+ * @param	n	The node to generate
+ */
+void CodeGen::visit(CallNode& n) {
+	for (auto arg = n.args; arg; arg = arg->next) {
+		arg->expr->accept(*this);
+		line = arg->line;
+		if (arg->promote)
+			comp.promote(arg->expr->kind, arg->param);
+	}
+
+	line = n.line;
+	comp.emit(OpCode::Call, n.depth, n.callee ? n.callee->entry : n.addr);
+}
+
+/// @param	n	The node to generate
+void CodeGen::visit(UnaryNode& n) {
+	n.operand->accept(*this);
+	line = n.line;
+	comp.emit(n.op);
+}
+
+/// @param	n	The node to generate
+void CodeGen::visit(BinaryNode& n) {
+	n.lhs->accept(*this);
+	n.rhs->accept(*this);
+
+	line = n.line;
+	if (n.promote)
+		comp.promote(n.lhs->kind, n.rhs->kind);
+	if (n.valid)
+		comp.emit(n.op);
+}
+
+/// @param	n	The node to generate
+void CodeGen::visit(LogicalNode& n) {
+	auto opnd = n.operands;
+	opnd->expr->accept(*this);
+
+	Comp::Logical l;
+	l.value = n.value;
+	line = opnd->line;
+	comp.truth(opnd->expr->kind);
+	auto jumps = comp.branch(l.value);			// The last operand's branches
+
+	for (opnd = opnd->next; opnd; opnd = opnd->next) {
+		l.jumps.insert(l.jumps.end(), jumps.begin(), jumps.end());
+		opnd->expr->accept(*this);
+		line = opnd->line;
+		comp.truth(opnd->expr->kind);
+
+		l.mark = comp.code->size();
+		l.last = comp.chained() ? make_shared<Comp::Logical>(comp.logic) : nullptr;
+		jumps = comp.branch(l.value);
+	}
+
+	l.tail = comp.emit(OpCode::Push, 0, l.value ? 0 : 1);
+	const auto jmp_pc = comp.emit(OpCode::Jump);
+	const auto value_pc = comp.emit(OpCode::Push, 0, l.value ? 1 : 0);
+	comp.patch(l.jumps, value_pc);
+	comp.patch(jumps, value_pc);
+	comp.patch({ jmp_pc }, comp.code->size());
+	l.end = comp.code->size();
+
+	comp.logic = l;
+}
+
+/// @param	n	The node to generate
+void CodeGen::visit(CompoundNode& n) {
+	statements(n.body);
+}
+
+/// @param	n	The node to generate
+void CodeGen::visit(AssignNode& n) {
+	n.value->accept(*this);
+	if (SymValue::Kind::None == n.target)
+		return;									// Reported by the parser
+
+	line = n.line;
+	if (n.type != n.value->kind)
+		comp.emit(Datum::Kind::Real == n.value->kind ? OpCode::RTOI : OpCode::ITOR);
+
+	if (SymValue::Kind::Variable == n.target)
+		comp.emitVarRef(n.depth, n.offset);
+	else										// Save value in the frame's retValue element
+		comp.emit(OpCode::PushVar, 0, FrameRetVal);
+	comp.emit(OpCode::Assign);
+}
+
+/// @param	n	The node to generate
+void CodeGen::visit(CallStmtNode& n) {
+	n.call->accept(*this);
+}
+
+/// @param	n	The node to generate
+void CodeGen::visit(WhileNode& n) {
+	const auto cond_pc = comp.code->size();
+	n.cond->accept(*this);
+
+	line = n.testLine;
+	const auto jumps = comp.branch(false);
+	statements(n.body);
+
+	line = n.endLine;
+	comp.emit(OpCode::Jump, 0, cond_pc);
+	comp.patch(jumps, comp.code->size());
+}
+
+/**
+ * If statements that just assign one of two values to a variable are converted to a Select.
+ *
+ * @param	n	The node to generate
+ */
+void CodeGen::visit(IfNode& n) {
+	n.cond->accept(*this);
+
+	const bool plain = !comp.chained();
+	line = n.testLine;
+	const auto jumps = comp.branch(false);
+	const auto then_pc = comp.code->size();
+	statements(n.then);
+
+	size_t else_pc = 0;
+	if (n.hasElse) {
+		line = n.elseLine;
+		else_pc = comp.emit(OpCode::Jump, 0, 0);
+	}
+
+	comp.patch(jumps, comp.code->size());
+
+	if (n.hasElse) {
+		statements(n.otherwise);
+		comp.patch({ else_pc }, comp.code->size());
+
+		if (plain)
+			comp.select(then_pc, else_pc);
+	}
+}
+
+/// @param	n	The node to generate
+void CodeGen::visit(RepeatNode& n) {
+	const size_t loop_pc = comp.code->size();
+	statements(n.body);
+	n.cond->accept(*this);
+
+	line = n.line;
+	comp.patch(comp.branch(false), loop_pc);
+}
+
+/**
+ * The limit, and step, which defaults to one, are evaluated once, and then kept on the stack,
+ * along with the variable's address, for the duration of the loop; ForTest skips the loop if
+ * the variable is already past the limit, and ForNext steps the variable, and loops back, unless
+ * the step would take it past the limit, in the direction of the step. So the variable is left
+ * at its last value, and never overflows.
+ *
+ * @param	n	The node to generate
+ */
+void CodeGen::visit(ForNode& n) {
+	n.init->accept(*this);
+	if (n.valid) {
+		line = n.initLine;
+		comp.emitVarRef(n.depth, n.offset);
+		comp.emit(OpCode::Assign);
+	}
+
+	n.limit->accept(*this);
+	line = n.testLine;
+	if (!n.step)
+		comp.emit(OpCode::Push, 0, 1);
+	else {
+		n.step->accept(*this);
+		line = n.testLine;
+	}
+
+	if (n.valid)
+		comp.emitVarRef(n.depth, n.offset);
+	const auto test_pc = comp.emit(OpCode::ForTest);
+
+	const auto body_pc = comp.code->size();
+	statements(n.body);
+
+	line = n.endLine;
+	comp.emit(OpCode::ForNext, 0, body_pc);
+	comp.patch({ test_pc }, comp.code->size());
+}
+
+/**
+ * The statements are generated first, then moved aside while the dispatch on the selector is
+ * emitted, so that the dispatch only branches forward. Labels are split into runs that are at
+ * least half dense; a single run is dispatched via one jump table, otherwise a binary decision
+ * tree finds the run's table.
+ *
+ * @param	n	The node to generate
+ */
+void CodeGen::visit(CaseNode& n) {
+	n.selector->accept(*this);
+
+	const auto start = comp.code->size();
+	Comp::CaseLabels labels;
+	Comp::Jumps ends;
+
+	for (auto arm = n.arms; arm; arm = arm->next) {
+		const auto addr = comp.code->size();
+		for (size_t i = 0; i < arm->nLabels; ++i)
+			labels.insert({ arm->labels[i], addr });	// Duplicates have been reported
+
+		statements(arm->body);
+		line = arm->line;
+		ends.push_back(comp.emit(OpCode::Jump));
+	}
+
+	auto other = comp.code->size();
+	if (n.hasElse)
+		statements(n.otherwise);
+
+	else if (!ends.empty()) {					// The last statement falls through
+		comp.code->pop_back();
+		comp.indextbl.pop_back();
+		ends.pop_back();
+		other = comp.code->size();
+	}
+	comp.patch(ends, comp.code->size());
+
+	comp.caseDispatch(start, labels, other);
+}
+
+/// @param	n	The node to generate
+void CodeGen::visit(BlockNode& n) {
+	enter(n);
+	for (auto sub = n.subs; sub; sub = sub->next)
+		sub->accept(*this);
+	leave(n);
+}
+
+// private
+
+/// @param	list	The statements to generate, if any
+void CodeGen::statements(StmtNode* list) {
+	for (; list; list = list->next)
+		list->accept(*this);
+}
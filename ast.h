@@ -0,0 +1,318 @@
+/** @file ast.h
+ *
+ * The PL/0C abstract syntax tree, and it's code generator
+ *
+ * @author Randy Merkel, Slowly but Surly Software.
+ * @copyright  (c) 2017 Slowly but Surly Software. All rights reserved.
+ */
+
+#ifndef	AST_H
+#define	AST_H
+
+#include <cstddef>
+
+#include "datum.h"
+#include "instr.h"
+#include "symbol.h"
+
+class Comp;
+class Visitor;
+
+/** An abstract syntax tree node
+ *
+ * Nodes are allocated from an Arena, and are never destroyed; they're freed along with the arena,
+ * so they must be trivially destructible, and refer to other nodes, or interned names, rather than
+ * own them. Nodes are resolved by the parser; identifiers refer to their declarations, expressions
+ * have their kinds, and errors have been reported.
+ *
+ * Nodes note the source line of the code they generate; the line of the token following the
+ * construct that the code is generated for.
+ */
+struct Node {
+	virtual void accept(Visitor& v) = 0;	///< Call v's visit for this node
+};
+
+/************************************************************************************************
+ *	Expressions
+ ************************************************************************************************/
+
+/// An expression, that leaves it's value on the stack
+struct ExprNode : public Node {
+	Datum::Kind		kind = Datum::Kind::Integer;	///< The expression's data type
+};
+
+/// An operand of a call, or of a logical operation
+struct Operand {
+	ExprNode*		expr = nullptr;			///< The operand
+	std::size_t		line = 0;				///< Source line of the code that follows it
+	bool			promote = false;		///< Promote to param?
+	Datum::Kind		param = Datum::Kind::Integer;	///< The formal parameters kind
+	Operand*		next = nullptr;			///< The next operand, if any
+};
+
+/// An expression that failed to parse; it's error has been reported, and it generates nothing
+struct InvalidNode : public ExprNode {
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// A constant, or a literal, value
+struct ConstNode : public ExprNode {
+	Datum			value;					///< The value
+	std::size_t		line = 0;				///< Source line
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// A variable's value
+struct VarNode : public ExprNode {
+	int				depth = 0;				///< Block levels from the reference to the variable
+	Datum::Integer	offset = 0;				///< Frame offset of the variable
+	std::size_t		line = 0;				///< Source line
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+struct BlockNode;
+
+/// A call of a function, or procedure
+struct CallNode : public ExprNode {
+	BlockNode*		callee = nullptr;		///< The subroutine, or null if not a subroutine
+	Datum			addr;					///< callee is null; the identifiers value
+	int				depth = 0;				///< Block levels from the call to the callee
+	Operand*		args = nullptr;			///< The actual parameters
+	std::size_t		line = 0;				///< Source line
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// A unary operation, e.g., - operand, or round(operand)
+struct UnaryNode : public ExprNode {
+	OpCode			op;						///< The operation
+	ExprNode*		operand;				///< The operand
+	std::size_t		line;					///< Source line
+
+	/// Construct op operand, of operand's kind
+	UnaryNode(OpCode o, ExprNode* e, std::size_t l) : op{o}, operand{e}, line{l} {
+		kind = e->kind;
+	}
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// A binary operation, e.g., lhs + rhs
+struct BinaryNode : public ExprNode {
+	OpCode			op;						///< The operation
+	bool			promote = true;			///< Promote the operands to a common type?
+	bool			valid = true;			///< False if the operation was in error, and is omitted
+	ExprNode*		lhs;					///< The left-hand operand
+	ExprNode*		rhs;					///< The right-hand operand
+	std::size_t		line;					///< Source line
+
+	/// Construct lhs op rhs, of lhs's kind
+	BinaryNode(OpCode o, ExprNode* l, ExprNode* r, std::size_t ln) : op{o}, lhs{l}, rhs{r}, line{ln} {
+		kind = l->kind;
+	}
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// A short-circuit logical operation, e.g., a && b && c, that evaluates to zero or one
+struct LogicalNode : public ExprNode {
+	bool			value = false;			///< Stop at the first operand whose value is value
+	Operand*		operands = nullptr;		///< The operands, in order
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/************************************************************************************************
+ *	Statements
+ ************************************************************************************************/
+
+/// A statement, in a list of statements
+struct StmtNode : public Node {
+	StmtNode*		next = nullptr;			///< The next statement in the list, if any
+};
+
+/// "begin" stmt { ";" stmt } "end"
+struct CompoundNode : public StmtNode {
+	StmtNode*		body = nullptr;			///< The statements
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// ident "=" expr
+struct AssignNode : public StmtNode {
+	ExprNode*		value = nullptr;		///< The value
+	SymValue::Kind	target = SymValue::Kind::None;	///< Variable, Function, or None if in error
+	Datum::Kind		type = Datum::Kind::Integer;	///< The target's type
+	int				depth = 0;				///< target is Variable; levels to the variable
+	Datum::Integer	offset = 0;				///< target is Variable; the variable's frame offset
+	std::size_t		line = 0;				///< Source line
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// ident "(" [ expr { "," expr } ] ")"
+struct CallStmtNode : public StmtNode {
+	CallNode*		call = nullptr;			///< The call
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// "while" expr "do" stmt
+struct WhileNode : public StmtNode {
+	ExprNode*		cond = nullptr;			///< The condition
+	StmtNode*		body = nullptr;			///< The body, if any
+	std::size_t		testLine = 0;			///< Source line of the branch on the condition
+	std::size_t		endLine = 0;			///< Source line of the jump back to the condition
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// "if" expr "then" stmt [ "else" stmt ]
+struct IfNode : public StmtNode {
+	ExprNode*		cond = nullptr;			///< The condition
+	StmtNode*		then = nullptr;			///< The then statement, if any
+	bool			hasElse = false;		///< Is there an else?
+	StmtNode*		otherwise = nullptr;	///< The else statement, if any
+	std::size_t		testLine = 0;			///< Source line of the branch on the condition
+	std::size_t		elseLine = 0;			///< Source line of the jump over the else
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// "repeat" stmt "until" expr
+struct RepeatNode : public StmtNode {
+	StmtNode*		body = nullptr;			///< The body, if any
+	ExprNode*		cond = nullptr;			///< The condition
+	std::size_t		line = 0;				///< Source line of the branch on the condition
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// "for" ident "=" expr "to" expr [ "step" expr ] "do" stmt
+struct ForNode : public StmtNode {
+	bool			valid = false;			///< Is ident an integer variable?
+	int				depth = 0;				///< Levels to the variable
+	Datum::Integer	offset = 0;				///< The variable's frame offset
+	ExprNode*		init = nullptr;			///< The initial value
+	ExprNode*		limit = nullptr;		///< The limit
+	ExprNode*		step = nullptr;			///< The step, or null for one
+	StmtNode*		body = nullptr;			///< The body, if any
+	std::size_t		initLine = 0;			///< Source line of the initial assignment
+	std::size_t		testLine = 0;			///< Source line of the ForTest
+	std::size_t		endLine = 0;			///< Source line of the ForNext
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// case-label { "," case-label } ":" stmt
+struct CaseArm {
+	Datum::Integer*	labels = nullptr;		///< The labels
+	std::size_t		nLabels = 0;			///< The number of labels
+	StmtNode*		body = nullptr;			///< The statement, if any
+	std::size_t		line = 0;				///< Source line of the jump to the end
+	CaseArm*		next = nullptr;			///< The next arm, if any
+};
+
+/// "case" expr "of" [ case-arm { ";" case-arm } ] [ "else" stmt ] "end"
+struct CaseNode : public StmtNode {
+	ExprNode*		selector = nullptr;		///< The selector
+	CaseArm*		arms = nullptr;			///< The arms, in order
+	bool			hasElse = false;		///< Is there an else?
+	StmtNode*		otherwise = nullptr;	///< The else statement, if any
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/// A block; main, or a procedure or function's, along with it's nested subroutines
+struct BlockNode : public Node {
+	const char*		name = nullptr;			///< The subroutine's name
+	int				level = 0;				///< The block level of the body
+	std::size_t		nParams = 0;			///< Number of formal parameters
+	bool			function = false;		///< A function, rather than a procedure?
+	int				locals = 0;				///< Number of local variables
+	Datum			entry;					///< The entry point, once generated
+	BlockNode*		subs = nullptr;			///< Nested subroutines, in order
+	BlockNode*		next = nullptr;			///< The next sibling subroutine, if any
+	StmtNode*		body = nullptr;			///< The statements
+	std::size_t		enterLine = 0;			///< Source line of the Enter
+	std::size_t		exitLine = 0;			///< Source line of the Ret, or Retf
+
+	void accept(Visitor& v);				///< Visit this node
+};
+
+/************************************************************************************************
+ *	Visitors
+ ************************************************************************************************/
+
+/// An AST visitor; a visit for each kind of node
+class Visitor {
+public:
+	virtual ~Visitor() {}					///< Destructor
+
+	virtual void visit(InvalidNode& n) = 0;	///< Visit an invalid expression
+	virtual void visit(ConstNode& n) = 0;	///< Visit a constant
+	virtual void visit(VarNode& n) = 0;		///< Visit a variable reference
+	virtual void visit(CallNode& n) = 0;	///< Visit a call
+	virtual void visit(UnaryNode& n) = 0;	///< Visit a unary operation
+	virtual void visit(BinaryNode& n) = 0;	///< Visit a binary operation
+	virtual void visit(LogicalNode& n) = 0;	///< Visit a logical operation
+
+	virtual void visit(CompoundNode& n) = 0;	///< Visit a compound statement
+	virtual void visit(AssignNode& n) = 0;	///< Visit an assignment
+	virtual void visit(CallStmtNode& n) = 0;	///< Visit a procedure call
+	virtual void visit(WhileNode& n) = 0;	///< Visit a while statement
+	virtual void visit(IfNode& n) = 0;		///< Visit an if statement
+	virtual void visit(RepeatNode& n) = 0;	///< Visit a repeat statement
+	virtual void visit(ForNode& n) = 0;		///< Visit a for statement
+	virtual void visit(CaseNode& n) = 0;	///< Visit a case statement
+
+	virtual void visit(BlockNode& n) = 0;	///< Visit a block
+};
+
+/** Code generator
+ *
+ * Generates code from the AST of a program, via it's Comp's emitters; branches on logical
+ * operations, selects, and case dispatch. Blocks are generated as a whole, via visit, or as
+ * they're parsed, via enter, once the block's declarations start, and leave, once it ends.
+ */
+class CodeGen : public Visitor {
+public:
+	std::size_t		line;					///< Source line of the code being generated
+
+	CodeGen(Comp& c) : line{0}, comp{c}, call_pc{0} {}	///< Generate code via c
+
+	void prologue(std::size_t callLine);	///< Emit the call to main, and the halt
+	void epilogue(BlockNode& main);			///< Patch the call to main
+
+	void enter(BlockNode& n);				///< Start generating a block
+	void leave(BlockNode& n);				///< Generate the block's statements
+
+	void visit(InvalidNode& n);
+	void visit(ConstNode& n);
+	void visit(VarNode& n);
+	void visit(CallNode& n);
+	void visit(UnaryNode& n);
+	void visit(BinaryNode& n);
+	void visit(LogicalNode& n);
+
+	void visit(CompoundNode& n);
+	void visit(AssignNode& n);
+	void visit(CallStmtNode& n);
+	void visit(WhileNode& n);
+	void visit(IfNode& n);
+	void visit(RepeatNode& n);
+	void visit(ForNode& n);
+	void visit(CaseNode& n);
+
+	void visit(BlockNode& n);
+
+private:
+	Comp&			comp;					///< The compiler whose code we're generating
+	std::size_t		call_pc;				///< Address of the call to main
+
+	void statements(StmtNode* list);		///< Generate a list of statements
+};
+
+#endif
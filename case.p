@@ -0,0 +1,45 @@
+{ case statements dispatch via a jump table if their labels are	}
+{ dense, or a binary decision tree of jump tables if they're not	}
+const three = 3;
+var state, n, x, y, z : integer;
+
+begin
+	{ A state machine; 0 -> 1 -> 3 -> 2 -> 4 -> halt }
+	state = 0;
+	n = 0;
+	while state != 4 do begin
+		case state of
+			0:		state = 1;
+			1:		state = three;
+			2:		state = 4;
+			three:	state = 2
+		end;
+		n = n + 1							{ s/b 4		}
+	end;
+
+	{ Sparse labels, and an else }
+	x = 0;
+	y = 0;
+	while x < 12 do begin
+		case x * 100 of
+			-5, 0, 100:	y = y + 1;
+			700:		y = y + 10;
+			1000, 1100:	y = y + 100
+			else		y = y + 1000
+		end;
+		x = x + 1
+	end;									{ s/b 7212	}
+
+	{ No else, and no matching label }
+	case y of
+		1:	z = 1;
+		2:	z = 2
+	end;
+
+	{ Labels more than the range of an integer apart }
+	case y of
+		-2147483647:	z = 1;
+		2147483647:		z = 2;
+		7212:			z = 3
+	end										{ s/b 3		}
+end.
@@ -0,0 +1,25 @@
+{ Locals whose lifetimes don't overlap share a frame slot at -O2	}
+var total : integer;
+
+procedure sums(n : integer)
+	var i, j, sum : integer;
+	begin
+		sum = 0;
+		i = 0;
+		while i < n do begin
+			sum = sum + i;
+			i = i + 1
+		end;
+		total = sum;
+
+		j = n;
+		repeat begin
+			total = total + j;
+			j = j - 1
+		end until j <= 0
+	end;
+
+begin
+	total = 0;
+	sums(5)
+end.
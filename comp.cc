@@ -9,10 +9,10 @@
 #include "comp.h"
 #include "interp.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iomanip>
 #include <iostream>
-#include <fstream>
 #include <limits>
 #include <vector>
 
@@ -27,7 +27,7 @@ using namespace std;
  * @param msg The error message
  */
 void Comp::error(const std::string& msg) {
-	cerr << progName << ": " << msg << " near line " << ts.lineNum << endl;
+	cerr << progName << ": " << msg << " near line " << ts.current().line << endl;
 	++nErrors;
 }
 
@@ -41,24 +41,39 @@ void Comp::error(const std::string& msg, const std::string& name) {
 	error (msg + " \'" + name + "\'");
 }
 
+/**
+ * Write a diagnostic in the form "msg 'name'", on standard error output, incrementing the error
+ * count.
+ * @param msg The error message
+ * @param name Identifier parameter to msg.
+ */
+void Comp::error(const std::string& msg, Interner::Id name) {
+	error (msg, ts.names().name(name));
+}
+
 /// @return The next token from the token stream
-Token Comp::next() {
-	const Token t = ts.get();
+const Token& Comp::next() {
+	ts.get();
+	const Token& t = ts.current();
 
 	if (Token::Unknown == t.kind) {
 		ostringstream oss;
 		oss
-			<< "Unknown token: '" << t.string_value
+			<< "Unknown token: '" << t.text
 			<< "', (0x" << hex << t.integer_value << ")";
 		error(oss.str());
 		return next();
 	}
 
+	if ((Token::IntegerNum == t.kind || Token::RealNum == t.kind) && t.overflow)
+		error("number out of range", string(t.text));
+
 	if (verbose)
 		cout
 			<< progName << ": getting '"
 			<< Token::toString(t.kind) << "', "
-			<< t.string_value << ", " << t.integer_value << "\n";
+			<< t.text
+			<< ", " << t.integer_value << "\n";
 
 	return t;
 }
@@ -99,15 +114,16 @@ bool Comp::expect(Token::Kind kind, bool get) {
  * @param set	Token kind set to test
  * @return true if current() is a member of set.
  */
-bool Comp::oneOf(Token::KindSet set) {
-	return set.end() != set.find(current());
+bool Comp::oneOf(const Token::KindSet& set) {
+	return set.contains(current());
 }
 
 /**
  * Assembles op, level, addr into a new instruction, and then appends the instruciton on
  * the end of code[], returning it's address/index in code[].
  *
- * Side effect; updates the cross index for the listing.
+ * Side effect; updates the cross index for the listing, with the line of the AST node being
+ * generated.
  *
  * @param	op		The pl0 instruction operation code
  * @param	level	The pl0 instruction block level value. Defaults to zero.
@@ -124,348 +140,409 @@ size_t Comp::emit(const OpCode op, int8_t level, Datum addr) {
 			<< addr.integer() << "\n";
 
 	code->push_back({op, level, addr});
-	indextbl.push_back(ts.lineNum);			// update the cross index
+	indextbl.push_back(gen->line);	// update the cross index
 
 	return code->size() - 1;				// so it's the address of just emitted instruction
 }
 
 /**
- * Convert stack operand to a real as necessary. 
- * @param	lhs	The type of the left-hand-side
- * @param	rhs	The type of the right-hand-side 
- * @return  The promoted to Datum kind
+ * @param	jumps	The branches to patch
+ * @param	addr	Their target address
  */
-Datum::Kind Comp::promote (Datum::Kind lhs, Datum::Kind rhs) {
-	if (lhs == rhs)
-		return lhs;							// nothing to do
+void Comp::patch(const Jumps& jumps, size_t addr) {
+	for (auto pc : jumps) {
+		if (verbose)
+			cout << progName << ": patching address at " << pc << " to " << addr << "\n";
+		(*code)[pc].addr = addr;
+	}
+}
 
-	else if (Datum::Kind::Real == rhs)
-		emit(OpCode::ITOR2);				// promote lhs (TOS-1) to a real
+/// @return true if the value on top of the stack was materialized by logic's tail.
+bool Comp::chained() const {
+	return 0 != logic.end && code->size() == logic.end;
+}
+
+/**
+ * Emits a branch, popping the value on top of the stack, that is taken if the value is when, and
+ * falls through otherwise. If the value is a logical operation, its tail is dropped, so that its
+ * operands branch directly.
+ *
+ * @param	when	Branch if the value is when
+ * @return	The branches to patch with the target address
+ */
+Comp::Jumps Comp::branch(bool when) {
+	if (chained()) {
+		const auto l = logic;
+		logic = Logical();
+		return branch(l, when);
+	}
+
+	if (when) emit(OpCode::Not);
+	return Jumps{ emit(OpCode::JNEQ) };
+}
 
+/**
+ * Replaces the last operand's branch, and the tail, of a logical operation with a branch on its
+ * value. The code ahead of the last operand's branch is left alone.
+ *
+ * @param	l		The logical operation
+ * @param	when	Branch if the value is when
+ * @return	The branches to patch with the target address
+ */
+Comp::Jumps Comp::branch(const Logical& l, bool when) {
+	code->resize(l.mark);
+	indextbl.resize(l.mark);
+	if (l.last)
+		logic = *l.last;
+
+	auto jumps = branch(when);					// The last operand decides the result
+	if (when == l.value)						// The others branch on when too...
+		jumps.insert(jumps.begin(), l.jumps.begin(), l.jumps.end());
 	else
-		emit(OpCode::ITOR);					// promote rhs to a real
+		patch(l.jumps, code->size());			// or fall through
 
-	return Datum::Kind::Real;
+	return jumps;
 }
 
 /**
- * Convert rhs of assign to real if necessary, or emit error would need to be
- * converted to an integer. 
+ * Converts a real on top of the stack to its truth value, i.e., value != 0.0, as the branches on
+ * a logical operation's operands test an integer.
+ *
+ * @param	kind	The type of the value
+ */
+void Comp::truth(Datum::Kind kind) {
+	if (Datum::Kind::Real == kind) {
+		emit(OpCode::Push, 0, 0.0);
+		emit(OpCode::NEQU);
+	}
+}
+
+/**
+ * Convert stack operand to a real as necessary. 
  * @param	lhs	The type of the left-hand-side
  * @param	rhs	The type of the right-hand-side 
+ * @return  The promoted to Datum kind
  */
-void Comp::assignPromote (Datum::Kind lhs, Datum::Kind rhs) {
+Datum::Kind Comp::promote (Datum::Kind lhs, Datum::Kind rhs) {
 	if (lhs == rhs)
-		;				// nothing to do
+		return lhs;							// nothing to do
 
-	else if (Datum::Kind::Real == rhs) {
-		error("rounding lhs to fit in an integer");
-		emit(OpCode::RTOI);				// promote lhs (TOS-1) to a real
-	}
+	else if (Datum::Kind::Real == rhs)
+		emit(OpCode::ITOR2);				// promote lhs (TOS-1) to a real
 
 	else
 		emit(OpCode::ITOR);					// promote rhs to a real
+
+	return Datum::Kind::Real;
 }
 
 /**
- * Uses the cross index to write a listing on the output stream
+ * Uses the cross index to write a listing on the output stream, interleaving the source lines
+ * with the code they generated.
  *
  * @param name		Name of the source file
- * @param source 	The source file stream
+ * @param source 	The source text
  * @param out		The listing file stream
  */
- void Comp::listing(const string& name, istream& source, ostream& out) {
-	string 			line;   				// Current source line
+ void Comp::listing(const string& name, string_view source, ostream& out) {
+	size_t			pos = 0;				// Start of the next source line
 	unsigned 		linenum = 1;			// source line number
 	Datum::Unsigned	addr = 0;				// code address (index)
 
+	auto getline = [&source, &pos] {		// Return the next line, or "" if there aren't any
+		const auto start = min(pos, source.size());
+		const auto end = min(source.find('\n', start), source.size());
+		pos = end + 1;
+		return source.substr(start, end - start);
+	};
+
 	while (addr < indextbl.size()) {
 		while (linenum <= indextbl[addr]) {	// Print lines that lead up to code[addr]...
-			getline(source, line);	++linenum;
-			cout << "# " << name << ", " << linenum << ": " << line << "\n" << internal;
+			const auto line = getline();	++linenum;
+			out << "# " << name << ", " << linenum << ": " << line << "\n" << internal;
 		}
 
 		disasm(out, addr, (*code)[addr]);	// Disasmble resulting instructions...
-		while (linenum-1 == indextbl[++addr])
+		while (++addr < indextbl.size() && linenum-1 == indextbl[addr])
 			disasm(out, addr, (*code)[addr]);
 	}
 
-	while (getline(source, line))			// Any lines following '.' ...
-		cout << "#" << name << ", " << linenum++ << ": " << line << "\n" << internal;
+	while (pos < source.size())				// Any lines following '.' ...
+		out << "#" << name << ", " << linenum++ << ": " << getline() << "\n" << internal;
 
 	out << endl;
 }
 
+/// Leave the current block's scope, purging its entries from the symbol table
+void Comp::purge() {
+	symtbl.leave([this](const SymbolTable::value_type& entry) {
+		if (verbose)
+			cout << progName << ": purging "
+				 << ts.names().name(entry.first) << ": "
+				 << SymValue::toString(entry.second.kind()) << ", "
+				 << static_cast<int>(entry.second.level()) << ", "
+				 << entry.second.value().integer()
+				 << " from the symbol table\n";
+	});
+}
+
 /**
- * @param level  The block level
+ * Local variables have an offset from the *end* of the current stack frame (bp), while
+ * parameters have a negative offset from the *start* of the frame -- offset locals by the size
+ * of the activation frame.
+ *
+ * @param	depth	The number of block levels from the reference to the variable
+ * @param	offset	The variable's offset; negative for parameters
  */
-void Comp::purge(int level) {
-	for (auto i = symtbl.begin(); i != symtbl.end(); ) {
-		if (i->second.level() == level) {
-			if (verbose)
-				cout << progName << ": purging "
-					 << i->first << ": "
-					 << SymValue::toString(i->second.kind()) << ", "
-					 << static_cast<int>(i->second.level()) << ", "
-					 << i->second.value().integer()
-					 << " from the symbol table\n";
-			i = symtbl.erase(i);
-
-		} else
-			++i;
-	}
+void Comp::emitVarRef(int depth, Datum::Integer offset) {
+	emit(OpCode::PushVar, depth, offset >= 0 ? offset + FrameSize : offset);
 }
 
- /**
-  * Local variables have an offset from the *end* of the current stack frame
-  * (bp), while parameters have a negative offset from the *start* of the frame
-  *  -- offset locals by the size of the activation frame.
-  *
-  *  @param	level	The current block level
-  *  @param	val		The variable symbol table entry
-  *  @return		Data type
-  */
- Datum::Kind Comp::emitVarRef(int level, const SymValue& val) {
-	const auto offset = val.value().integer() >= 0 ? val.value().integer() + FrameSize : val.value().integer();
-	emit(OpCode::PushVar, level - val.level(), offset);
-	return val.value().kind();
- }
-
 /// Consume, and return the closest identifer in the token stream...
 SymbolTable::iterator Comp::identRef() {
-	const string id = ts.current().string_value;	// Copy and, then 
+	const auto id = ts.current().symbol;			// Note and, then 
 	next();											// Consme the identifier...
 
-	auto range = symtbl.equal_range(id);			// Should have already been defined...
-	if (range.first == range.second) {
+	auto it = symtbl.find(id);						// Should have already been defined...
+	if (it == symtbl.end())
 		error("Undefined identifier", id);
-		return symtbl.end();
 
-	} else {										// Find the closest...
-		auto closest = range.first;
-		for (auto it = closest; it != range.second; ++it)
-			if (it->second.level() > closest->second.level())
-				closest = it;
-
-		return closest;
-	}
+	return it;
 }
 
 /**
- * Push a variable's value, a constant value, or invoke, and push the results,
- * of a function.
- *      ident | ident "(" [ ident { "," ident } ] ")"
+ * ident | ident "(" [ expr { "," expr } ] ")"
  *
- * @param	level	The current block level 
- * @return	Data type 
+ * @param	level	The current block level
+ * @return	The constant, variable or function call
  */
- Datum::Kind Comp::identifier(int level) {
-	Datum::Kind	kind = Datum::Kind::Integer;	// Identifier type
-
+ExprNode* Comp::identifier(int level) {
 	auto it = identRef();
 	if (it != symtbl.end()) {
 		switch (it->second.kind()) {
-		case SymValue::Kind::Constant:
-			kind = it->second.value().kind();	// Assume it's the symbol's value type
-			emit(OpCode::Push, 0, it->second.value());
-			break;
+		case SymValue::Kind::Constant: {
+				auto n = arena.make<ConstNode>();
+				n->value = it->second.value();
+				n->kind = n->value.kind();
+				n->line = ts.current().line;
+				return n;
+			}
 
-		case SymValue::Kind::Variable:
-			kind = it->second.type();			// Use the variable's type
-			emitVarRef(level, it->second);
-			emit(OpCode::Eval);
-			break;
+		case SymValue::Kind::Variable: {
+				auto n = arena.make<VarNode>();
+				n->kind = it->second.type();
+				n->depth = level - it->second.level();
+				n->offset = it->second.value().integer();
+				n->line = ts.current().line;
+				return n;
+			}
 
 		case SymValue::Kind::Function:
-			kind = it->second.type();		// Use the function return type
-			callStmt(it->first, it->second, level);
-			break;
+			return callStmt(it->first, it->second, level);
 
 		default:
 			error("Identifier is not a constant, variable or function", it->first);
 		}
 	}
 
-	return kind;
+	return arena.make<InvalidNode>();
 }
 
-/** 
+/**
  * ident                                |
  * "round" "(" expr ")"					|
  * ident "(" [ expr { "," expr } ")"	|
- * number                              
+ * number                             
  * "(" expr ")"
- * 
+ *
  * @param	level	The current block level.
- * @return	Data type 
+ * @return	The factor
  */
-Datum::Kind Comp::factor(int level) {
-	auto kind = Datum::Kind::Integer;	// factor data type
-
+ExprNode* Comp::factor(int level) {
 	if (accept(Token::Identifier, false))
-		kind = identifier(level);
+		return identifier(level);
 
-	else if (accept(Token::Round))  {	// round(expr) to an integer
+	else if (accept(Token::Round))  {			// round(expr) to an integer
 		expect(Token::OpenParen);
-		kind = expression(level);
-		expect(Token::CloseParen);	
-		if (Datum::Kind::Integer != kind) {
-			emit(OpCode::RTOI);
-			kind = Datum::Kind::Integer;
+		auto e = expression(level);
+		expect(Token::CloseParen);
+		if (Datum::Kind::Integer != e->kind) {
+			e = arena.make<UnaryNode>(OpCode::RTOI, e, ts.current().line);
+			e->kind = Datum::Kind::Integer;
 		}
-		
+		return e;
+
 	} else if (accept(Token::IntegerNum, false)) {
-		emit(OpCode::Push, 0, ts.current().integer_value);
+		auto n = arena.make<ConstNode>();
+		n->value = ts.current().integer_value;
+		n->line = ts.current().line;
 		expect(Token::IntegerNum);
-		
+		return n;
+
 	} else if (accept(Token::RealNum, false)) {
-		kind = Datum::Kind::Real;
-		emit(OpCode::Push, 0, ts.current().real_value);
+		auto n = arena.make<ConstNode>();
+		n->value = ts.current().real_value;
+		n->kind = Datum::Kind::Real;
+		n->line = ts.current().line;
 		expect(Token::RealNum);
+		return n;
 
 	} else if (accept(Token::OpenParen)) {
-		kind = expression(level);
+		auto e = expression(level);
 		expect(Token::CloseParen);
+		return e;
+	}
 
-	} else {
-		error("factor: syntax error; expected ident | num | { expr }, but got:",
-			Token::toString(current()));
-		next();
+	error("factor: syntax error; expected ident | num | { expr }, but got:",
+		Token::toString(current()));
+	next();
+
+	return arena.make<InvalidNode>();
+}
+
+/**
+ * lhs { op operand }, where op is "&&", whose operands are facts, or "||", whose operands are
+ * unary-exprs. Evaluation stops at the first operand that decides the result; false for "&&", or
+ * true for "||". Real operands are true if they're not 0.0.
+ *
+ * @param	lhs		The left-hand operand
+ * @param	level	The current block level
+ * @param	op		Token::AND or Token::OR
+ * @return	The logical operation
+ */
+ExprNode* Comp::logical(ExprNode* lhs, int level, Token::Kind op) {
+	auto n = arena.make<LogicalNode>();
+	n->value = Token::OR == op;
+
+	auto opnd = n->operands = arena.make<Operand>();
+	opnd->expr = lhs;
+	opnd->line = ts.current().line;
+
+	while (accept(op)) {
+		opnd = opnd->next = arena.make<Operand>();
+		opnd->expr = Token::AND == op ? factor(level) : unary(level);
+		opnd->line = ts.current().line;
 	}
 
-	return kind;
+	return n;
 }
 
 /**
  * fact { ("*"|"/"|"%"|"&"|"&&"|"<<"|">>") fact } ;
  *
- * @param level	The current block level 
- * @return	Data type  
+ * @param level	The current block level
+ * @return	The term
  */
-Datum::Kind Comp::term(int level) {
-	const auto lhs = factor(level);
+ExprNode* Comp::term(int level) {
+	static constexpr Token::KindSet ops {
+		Token::Multiply,	Token::Divide,	Token::Mod,		Token::BitAND,
+		Token::AND,			Token::ShiftL,	Token::ShiftR
+	};
 
-	for (;;) {
-		if (accept(Token::Multiply)) {
-			const auto rhs = factor(level);	
-			promote(lhs, rhs);
-			emit(OpCode::Mul);
-			
-		} else if (accept(Token::Divide)) {
-			const auto rhs = factor(level);
-			promote(lhs, rhs);
-			emit(OpCode::Div);	
-			
-		} else if (accept(Token::Mod)) {
-			const auto rhs = factor(level);
-			promote(lhs, rhs);
-			emit(OpCode::Rem);
-
-		} else if (accept(Token::BitAND)) {
-			auto rhs = factor(level);
-			rhs = promote(lhs, rhs);
-			if (Datum::Kind::Real == lhs || Datum::Kind::Real == rhs)
+	auto lhs = factor(level);
+
+	while (oneOf(ops)) {
+		if (accept(Token::AND, false)) {
+			lhs = logical(lhs, level, Token::AND);
+			continue;
+		}
+
+		OpCode op = OpCode::Mul;
+		if (accept(Token::Multiply))		op = OpCode::Mul;
+		else if (accept(Token::Divide))		op = OpCode::Div;
+		else if (accept(Token::Mod))		op = OpCode::Rem;
+		else if (accept(Token::BitAND))		op = OpCode::BAND;
+		else if (accept(Token::ShiftL))		op = OpCode::LShift;
+		else if (accept(Token::ShiftR))		op = OpCode::RShift;
+
+		const auto rhs = factor(level);
+		auto n = arena.make<BinaryNode>(op, lhs, rhs, ts.current().line);
+		const bool mixed = lhs->kind != rhs->kind;		// Promoted to a real?
+
+		switch (op) {
+		case OpCode::BAND:
+			if (mixed || Datum::Kind::Real == lhs->kind) {
 				error("binary bit operation with real operand(s)");
-			else
-				emit(OpCode::BAND); 
-
-		} else if (accept(Token::AND)) {
-			const auto rhs = factor(level);
-			promote(lhs, rhs);
-			emit(OpCode::LAND);
-
-
-		 } else if (accept(Token::ShiftL)) {
-			 const auto rhs = factor(level);
-			 if (Datum::Kind::Real == lhs || Datum::Kind::Real == rhs)
-				 error("Shift operator with real operand(s)");
-			 else 
-				 emit(OpCode::LShift);
-
-		 } else if (accept(Token::ShiftR)) {
-			 const auto rhs = factor(level);
-			 if (Datum::Kind::Real == lhs || Datum::Kind::Real == rhs)
-				 error("Shift operator with real operand(s)");
-			 else 
-				 emit(OpCode::RShift);	
-
-		 } else if (accept(Token::ShiftL)) {
-			 const auto rhs = factor(level);
-			 if (Datum::Kind::Real == lhs || Datum::Kind::Real == rhs)
-				 error("Shift operator with real operand(s)");
-			 else 
-				 emit(OpCode::LShift);	
-
-		} else
+				n->valid = false;
+			}
+			break;
+
+		case OpCode::LShift:
+		case OpCode::RShift:
+			n->promote = false;
+			if (Datum::Kind::Real == lhs->kind || Datum::Kind::Real == rhs->kind) {
+				error("Shift operator with real operand(s)");
+				n->valid = false;
+			}
 			break;
+
+		default:
+			if (mixed)
+				n->kind = Datum::Kind::Real;
+		}
+
+		lhs = n;
 	}
 
 	return lhs;
 }
 
 /**
- * [ ("+" | "-" | "!" | "~") ] fact
- * @param	level	The current block level 
- * @return	Data type 
+ * [ ("+" | "-" | "!" | "~") ] term
+ * @param	level	The current block level
+ * @return	The unary expression
  */
-Datum::Kind Comp::unary(int level) {
-	auto kind = Datum::Kind::Integer;		// Default factor data type
-
-	if (accept(Token::Add)) 
-		kind = term(level);					// ignore unary + 
+ExprNode* Comp::unary(int level) {
+	if (accept(Token::Add))
+		return term(level);				// ignore unary +
 
 	else if (accept(Token::Subtract)) {
-		kind = term(level);
-		emit(OpCode::Neg);
+		auto e = term(level);
+		return arena.make<UnaryNode>(OpCode::Neg, e, ts.current().line);
 
 	} else if (accept(Token::NOT)) {
-		kind = term(level);
-		emit(OpCode::Not);
+		auto e = term(level);
+		return arena.make<UnaryNode>(OpCode::Not, e, ts.current().line);
 
 	} else if (accept(Token::Complament)) {
-		kind = term(level);
-		if (Datum::Kind::Integer == kind)
-			emit(OpCode::Comp);
-		else
-			error("unary: complement a Real");
+		auto e = term(level);
+		if (Datum::Kind::Integer == e->kind)
+			return arena.make<UnaryNode>(OpCode::Comp, e, ts.current().line);
 
-	} else									
-		kind = term(level);
+		error("unary: complement a Real");
+		return e;
+	}
 
-	return kind;
+	return term(level);
 }
 
 /**
- * term { ("+" | "-" | "!" | "~") term } ;
- * @param	level	The current block level. 
- * @return	Data type  
+ * unary { ("+" | "-" | "|" | "||") unary } ;
+ * @param	level	The current block level
+ * @return	The simple expression
  */
-Datum::Kind Comp::simpleExpr(int level) {
-	const auto lhs = unary(level);
+ExprNode* Comp::simpleExpr(int level) {
+	static constexpr Token::KindSet ops { Token::Add, Token::Subtract, Token::BitOR, Token::OR };
 
-	for (;;) {
-		if (accept(Token::Add)) {
-			const auto rhs =  unary(level);
-			promote(lhs, rhs);
-			emit(OpCode::Add);
-
-		} else if (accept(Token::Subtract)) {
-			const auto rhs = unary(level);
-			promote(lhs, rhs);
-			emit(OpCode::Sub);
-
-		} else if (accept(Token::BitOR)) {
-			const auto rhs = unary(level);
-			promote(lhs, rhs);
-			emit(OpCode::BOR);
-
-		} else if (accept(Token::OR)) {
-			const auto rhs = unary(level);
-			promote(lhs, rhs);
-			emit(OpCode::LOR);
-
-		} else
-			break;
+	auto lhs = unary(level);
+
+	while (oneOf(ops)) {
+		if (accept(Token::OR, false)) {
+			lhs = logical(lhs, level, Token::OR);
+			continue;
+		}
+
+		OpCode op = OpCode::Add;
+		if (accept(Token::Add))				op = OpCode::Add;
+		else if (accept(Token::Subtract))	op = OpCode::Sub;
+		else if (accept(Token::BitOR))		op = OpCode::BOR;
+
+		const auto rhs = unary(level);
+		auto n = arena.make<BinaryNode>(op, lhs, rhs, ts.current().line);
+		if (OpCode::BOR != op && lhs->kind != rhs->kind)
+			n->kind = Datum::Kind::Real;
+
+		lhs = n;
 	}
 
 	return lhs;
@@ -473,45 +550,30 @@ Datum::Kind Comp::simpleExpr(int level) {
 
 /**
  * simpleExpr { ("<"|"<="|"=="|">="|">"|"!=") simpleExpr } ;
- * @param level	The current block level 
- * @return	Data type. 
+ * @param level	The current block level
+ * @return	The expression, of the first simple expression's kind
  */
-Datum::Kind Comp::expression(int level) {
-	const auto lhs = simpleExpr(level);
+ExprNode* Comp::expression(int level) {
+	static constexpr Token::KindSet ops {
+		Token::LTE,	Token::LT,	Token::GT,	Token::GTE,	Token::EQU,	Token::NEQU
+	};
 
-	for (;;) {
-		if (accept(Token::LTE)) {
-			const auto rhs = simpleExpr(level);
-			promote(lhs, rhs);
-			emit(OpCode::LTE);
-
-		} else if (accept(Token::LT)) {
-			const auto rhs = simpleExpr(level);
-			promote(lhs, rhs);
-			emit(OpCode::LT);
-
-		} else if (accept(Token::GT)) {
-			const auto rhs = simpleExpr(level);
-			promote(lhs, rhs);
-			emit(OpCode::GT);
-			
-		} else if (accept(Token::GTE)) {
-			const auto rhs = simpleExpr(level);
-			promote(lhs, rhs);
-			emit(OpCode::GTE);
-			
-		} else if (accept(Token::EQU)) {
-			const auto rhs = simpleExpr(level);
-			promote(lhs, rhs);
-			emit(OpCode::EQU);
-
-		} else if (accept(Token::NEQU)) {
-			const auto rhs = simpleExpr(level);
-			promote(lhs, rhs);
-			emit(OpCode::NEQU);
-
-		} else
-			break;
+	auto lhs = simpleExpr(level);
+	const auto kind = lhs->kind;
+
+	while (oneOf(ops)) {
+		OpCode op = OpCode::LTE;
+		if (accept(Token::LTE))				op = OpCode::LTE;
+		else if (accept(Token::LT))			op = OpCode::LT;
+		else if (accept(Token::GT))			op = OpCode::GT;
+		else if (accept(Token::GTE))		op = OpCode::GTE;
+		else if (accept(Token::EQU))		op = OpCode::EQU;
+		else if (accept(Token::NEQU))		op = OpCode::NEQU;
+
+		auto rhs = simpleExpr(level);
+		auto n = arena.make<BinaryNode>(op, lhs, rhs, ts.current().line);
+		n->kind = kind;							// Each comparison promotes with the first operand
+		lhs = n;
 	}
 
 	return lhs;
@@ -523,21 +585,25 @@ Datum::Kind Comp::expression(int level) {
  * @param	name	The identifier value
  * @param	val		The identifiers symbol table entry value
  * @param	level	The current block level.
+ * @return	The assignment
  */
-void Comp::assignStmt(const string& name, const SymValue& val, int level) {
-	const auto rhs = expression(level);
+StmtNode* Comp::assignStmt(Interner::Id name, const SymValue& val, int level) {
+	auto n = arena.make<AssignNode>();
+	n->value = expression(level);
 
 	switch(val.kind()) {
 	case SymValue::Kind::Variable:
-		assignPromote(val.type(), rhs);
-		emitVarRef(level, val);
-		emit(OpCode::Assign);
-		break;
-
-	case SymValue::Kind::Function:		// Save value in the frame's retValue element
-		assignPromote(val.type(), rhs);
-		emit(OpCode::PushVar, 0, FrameRetVal);
-		emit(OpCode::Assign);
+	case SymValue::Kind::Function:
+		if (val.type() != n->value->kind && Datum::Kind::Real == n->value->kind)
+			error("rounding lhs to fit in an integer");
+
+		n->target = val.kind();
+		n->type = val.type();
+		if (SymValue::Kind::Variable == val.kind()) {
+			n->depth = level - val.level();
+			n->offset = val.value().integer();
+		}
+		n->line = ts.current().line;
 		break;
 
 	case SymValue::Kind::Constant:
@@ -551,6 +617,8 @@ void Comp::assignStmt(const string& name, const SymValue& val, int level) {
 	default:
 		assert(false);
 	}
+
+	return n;
 }
 
 /**
@@ -560,18 +628,28 @@ void Comp::assignStmt(const string& name, const SymValue& val, int level) {
  *
  * @param	name	The identifier value
  * @param	val		The identifiers symbol table entry value
- * @param	level	The current block level 
+ * @param	level	The current block level
+ * @return	The call
  */
-void Comp::callStmt(const string& name, const SymValue& val, int level) {
+CallNode* Comp::callStmt(Interner::Id name, const SymValue& val, int level) {
+	auto n = arena.make<CallNode>();
+	n->kind = val.type();
 	expect(Token::OpenParen);
 
 	const auto& params = val.params();		// Formal parameter kinds
 	unsigned nParams = 0;					// Count actual parameters
+	Operand** tail = &n->args;
 	if (!accept(Token::CloseParen, false))
 		do {								// collect actual parameters
-			const auto kind = expression(level);
-			if (params.size() > nParams)
-				promote(kind, params[nParams]);
+			auto arg = *tail = arena.make<Operand>();
+			tail = &arg->next;
+
+			arg->expr = expression(level);
+			arg->line = ts.current().line;
+			if (params.size() > nParams) {
+				arg->promote = true;
+				arg->param = params[nParams];
+			}
 			++nParams;
 
 		} while (accept (Token::Comma));
@@ -580,34 +658,51 @@ void Comp::callStmt(const string& name, const SymValue& val, int level) {
 
 	if (nParams != params.size()) {			// Is the caller passing right # of params?
 		ostringstream oss;
-		oss << "passing " << nParams 
+		oss << "passing " << nParams
 			<< " parameters where " << params.size()
 			<< " where expected";
 		error(oss.str());
 	}
 
-	if (SymValue::Kind::Procedure != val.kind() && SymValue::Kind::Function != val.kind())
+	if (SymValue::Kind::Procedure != val.kind() && SymValue::Kind::Function != val.kind()) {
 		error("Identifier is not a function or procedure", name);
+		n->addr = val.value();
+	} else
+		n->callee = blocks[val.value().uinteger()];
 
-	emit(OpCode::Call, level - val.level(), val.value());
+	n->depth = level - val.level();
+	n->line = ts.current().line;
+	return n;
 }
 
 /**
  *     ident "=" expr | ident "(" [ ident { "," ident } ] ")"
  *
  * @param	level	The current block level
+ * @return	The statement, or null if there isn't one
  */
-void Comp::identStmt(int level) {
+StmtNode* Comp::identStmt(int level) {
 	auto it = identRef();
+	if (it == symtbl.end()) {			// Already reported; skip the assignment
+		if (!accept(Token::Assign))
+			return nullptr;
+
+		auto n = arena.make<AssignNode>();
+		n->value = expression(level);
+		return n;
+	}
 
 	if (accept(Token::Assign))			// ident "=" expression
-		assignStmt(it->first, it->second, level);
+		return assignStmt(it->first, it->second, level);
 
-	else if (SymValue::Kind::Function == it->second.kind())
+	else if (SymValue::Kind::Function == it->second.kind()) {
 		error("calling function without assignment", it->first);
+		return nullptr;
+	}
 
-	else
-		callStmt(it->first, it->second, level);
+	auto n = arena.make<CallStmtNode>();
+	n->call = callStmt(it->first, it->second, level);
+	return n;
 }
 
 
@@ -615,96 +710,427 @@ void Comp::identStmt(int level) {
  * "while" expr "do" statement...
  *
  * @param	level	The current block level.
+ * @return	The while statement
  */
- void Comp::whileStmt(int level) {
-	const auto cond_pc = code->size();	// Start of while expr
-	expression(level);
+StmtNode* Comp::whileStmt(int level) {
+	auto n = arena.make<WhileNode>();
+	n->cond = expression(level);
+	n->testLine = ts.current().line;
+
+	expect(Token::Do);
+	n->body = statement(level);
+	n->endLine = ts.current().line;
 
-	// jump if expr is false...
-	const auto jmp_pc = emit(OpCode::JNEQ, 0, 0);
-	expect(Token::Do);					// consume "do"
-	statement(level);
+	return n;
+}
+
+/**
+ * @param	from	The first instruction
+ * @param	to		The instruction following the last
+ * @return	true if from..to is no more than maxSelect instructions, that can't branch, call or
+ * 			fault, e.g., divide by zero, and don't assign.
+ */
+bool Comp::selectable(size_t from, size_t to) const {
+	if (from >= to || to - from > maxSelect)
+		return false;
+
+	for (auto pc = from; pc < to; ++pc)
+		switch((*code)[pc].op) {
+		case OpCode::Not:	case OpCode::Neg:	case OpCode::Comp:
+		case OpCode::ITOR:	case OpCode::ITOR2:	case OpCode::RTOI:
+		case OpCode::Add:	case OpCode::Sub:	case OpCode::Mul:
+		case OpCode::BOR:	case OpCode::BAND:	case OpCode::BXOR:	case OpCode::LShift: case OpCode::RShift:
+		case OpCode::LT:	case OpCode::LTE:	case OpCode::EQU:	case OpCode::GTE:	case OpCode::GT:
+		case OpCode::NEQU:	case OpCode::LOR:	case OpCode::LAND:
+		case OpCode::Push:	case OpCode::PushVar:	case OpCode::Eval:
+			break;
 
-	emit(OpCode::Jump, 0, cond_pc);		// Jump back to expr test...
+		default:
+			return false;
+		}
+
+	return true;
+}
+
+/**
+ * Converts
+ *
+ * 		cond, jneq else, value1, pushvar x, assign, jump end, else: value2, pushvar x, assign
+ *
+ * into the branchless
+ *
+ * 		cond, value1, value2, select, pushvar x, assign
+ *
+ * if both values are selectable, and the variables are the same. Both values are evaluated,
+ * so they're limited to maxSelect instructions that have no side effects.
+ *
+ * @param	then_pc	Address of the then statement, following the jneq
+ * @param	else_pc	Address of the jump over the else statement
+ * @return	true if the if statement was converted
+ */
+bool Comp::select(size_t then_pc, size_t else_pc) {
+	const auto end = code->size();
+	const auto& c = *code;
+
+	if (	then_pc + 3 > else_pc || else_pc + 4 > end
+		||	OpCode::JNEQ != c[then_pc - 1].op
+		||	OpCode::Assign != c[else_pc - 1].op		||	OpCode::PushVar != c[else_pc - 2].op
+		||	OpCode::Assign != c[end - 1].op			||	OpCode::PushVar != c[end - 2].op
+		||	c[else_pc - 2].level != c[end - 2].level
+		||	c[else_pc - 2].addr.integer() != c[end - 2].addr.integer()
+		||	!selectable(then_pc, else_pc - 2)		||	!selectable(else_pc + 1, end - 2))
+		return false;
+
+	InstrVector instrs;
+	SourceIndex lines;
+	auto append = [&](size_t from, size_t to) {
+		instrs.insert(instrs.end(), code->begin() + from, code->begin() + to);
+		lines.insert(lines.end(), indextbl.begin() + from, indextbl.begin() + to);
+	};
+
+	append(then_pc, else_pc - 2);					// value1
+	append(else_pc + 1, end - 2);					// value2
+	instrs.push_back({ OpCode::Select, 0, 0 });
+	lines.push_back(indextbl[end - 2]);
+	append(end - 2, end);							// pushvar x, assign
 
 	if (verbose)
-		cout << progName << ": patching address at " << jmp_pc << " to " << code->size() << "\n";
-	(*code)[jmp_pc].addr = code->size(); 
- }
+		cout << progName << ": converting if at " << then_pc - 1 << " to a select\n";
+
+	code->resize(then_pc - 1);
+	indextbl.resize(then_pc - 1);
+	code->insert(code->end(), instrs.begin(), instrs.end());
+	indextbl.insert(indextbl.end(), lines.begin(), lines.end());
+
+	return true;
+}
 
 /**
- *  "if" expr "then" statement1 [ "else" statement2 ]
+ * "if" expr "then" statement1 [ "else" statement2 ]
+ *
+ * @param	level	The current block level
+ * @return	The if statement
  */
- void Comp::ifStmt(int level) {
-	expression(level);
+StmtNode* Comp::ifStmt(int level) {
+	auto n = arena.make<IfNode>();
+	n->cond = expression(level);
+	n->testLine = ts.current().line;
 
-	// Jump if conditon is false
-	const size_t jmp_pc = emit(OpCode::JNEQ, 0, 0);
-	expect(Token::Then);							// Consume "then"
-	statement(level);
+	expect(Token::Then);
+	n->then = statement(level);
 
-	// Jump over else statement, but only if there is an else
-	const bool Else = accept(Token::Else);
-	size_t else_pc = 0;
-	if (Else) else_pc = emit(OpCode::Jump, 0, 0);
+	if ((n->hasElse = accept(Token::Else))) {
+		n->elseLine = ts.current().line;
+		n->otherwise = statement(level);
+	}
 
-	if (verbose)
-		cout << progName << ": patching address at " << jmp_pc << " to " << code->size() << "\n";
-	(*code)[jmp_pc].addr = code->size();
+	return n;
+}
 
-	if (Else) {
-		statement(level);
+/**
+ * "repeat" statement "until" expr
+ *
+ * @param	level 	The current block level
+ * @return	The repeat statement
+ */
+StmtNode* Comp::repeatStmt(int level) {
+	auto n = arena.make<RepeatNode>();
+	n->body = statement(level);
+	expect(Token::Until);
+	n->cond = expression(level);
+	n->line = ts.current().line;
+
+	return n;
+}
 
-		if (verbose)
-			cout << progName << ": patching address at " << else_pc << " to " << code->size() << "\n";
-		(*code)[else_pc].addr = code->size();
+/**
+ * "for" ident "=" expr "to" expr [ "step" expr ] "do" statement
+ *
+ * A constant step of zero is an error; a step that evaluates to zero at run time loops forever.
+ *
+ * @param	level	The current block level
+ * @return	The for statement
+ */
+StmtNode* Comp::forStmt(int level) {
+	auto n = arena.make<ForNode>();
+
+	const auto name = ts.current().symbol;
+	auto it = symtbl.end();
+	if (expect(Token::Identifier, false))
+		it = identRef();
+
+	n->valid = it != symtbl.end()
+		&& SymValue::Kind::Variable == it->second.kind()
+		&& Datum::Kind::Integer == it->second.type();
+	if (it != symtbl.end() && !n->valid)
+		error("for loop variable is not an integer variable", name);
+
+	if (n->valid) {
+		n->depth = level - it->second.level();
+		n->offset = it->second.value().integer();
+	}
+
+	expect(Token::Assign);
+	n->init = expression(level);
+	if (Datum::Kind::Integer != n->init->kind)
+		error("for loop initial value is not an integer");
+	n->initLine = ts.current().line;
+
+	expect(Token::To);
+	n->limit = expression(level);
+	if (Datum::Kind::Integer != n->limit->kind)
+		error("for loop limit is not an integer");
+
+	if (accept(Token::Step)) {
+		n->step = expression(level);
+		const auto c = dynamic_cast<ConstNode*>(n->step);
+		if (Datum::Kind::Integer != n->step->kind)
+			error("for loop step is not an integer");
+		else if (c && 0 == c->value.integer())
+			error("for loop step is zero");
+	}
+	n->testLine = ts.current().line;
+
+	expect(Token::Do);
+	n->body = statement(level);
+	n->endLine = ts.current().line;
+
+	return n;
+}
+
+/**
+ * [ "-" ] integer | ident, where ident is an integer constant
+ *
+ * @return	The label's value
+ */
+Datum::Integer Comp::caseLabel() {
+	const bool negative = accept(Token::Subtract);
+	Datum::Integer label = 0;
+
+	if (accept(Token::IntegerNum, false)) {
+		label = ts.current().integer_value;
+		next();										// Consume the number
+
+	} else if (accept(Token::Identifier, false)) {
+		auto it = identRef();
+		if (it != symtbl.end()) {
+			if (	SymValue::Kind::Constant != it->second.kind()
+				||	Datum::Kind::Integer != it->second.value().kind())
+				error("case label is not an integer constant", it->first);
+			else
+				label = it->second.value().integer();
+		}
+
+	} else {
+		error("expected an integer case label, got", Token::toString(current()));
+		next();
+	}
+
+	return negative ? -label : label;
+}
+
+/**
+ * Emits a bounds checked jump table for the labels in run, indexed by the selector, on top of the
+ * stack, less the first label.
+ *
+ * @param			run		The labels
+ * @param			other	The address of the else statement, or the end of the case statement
+ * @param[in,out]	arms	The table's jumps are appended to arms
+ */
+void Comp::jumpTable(const CaseRun& run, size_t other, Jumps& arms) {
+	const auto low = run.first->first;
+	const auto high = run.second->first;
+
+	if (0 != low) {
+		emit(OpCode::Push, 0, low);
+		emit(OpCode::Sub);
 	}
- }
-
- /**
-  * "repeat" statement "until" expr
-  *
-  * @param	level 	The current block level
-  */
- void Comp::repeatStmt(int level) {
-	 const size_t loop_pc = code->size();			// jump here until expr fails
-	 statement(level);
-	 expect(Token::Until);
-	 expression(level);
-	 emit(OpCode::JNEQ, 0, loop_pc);
- }
+	emit(OpCode::JTab, 0, static_cast<Datum::Integer>(static_cast<long long>(high) - low + 1));
+
+	auto it = run.first;
+	for (long long label = low; label <= high; ++label)
+		if (label == it->first)
+			arms.push_back(emit(OpCode::Jump, 0, (it++)->second));
+		else
+			arms.push_back(emit(OpCode::Jump, 0, other));
+
+	arms.push_back(emit(OpCode::Jump, 0, other));	// Out of range
+}
+
+/**
+ * Emits a binary decision tree, comparing the selector, on top of the stack, with the first label
+ * of the middle run, down to a jump table for a single run.
+ *
+ * @param			runs	The runs of labels, in order
+ * @param			lo		The first run to dispatch to
+ * @param			hi		The last run to dispatch to
+ * @param			other	The address of the else statement, or the end of the case statement
+ * @param[in,out]	arms	The jump tables jumps are appended to arms
+ */
+void Comp::dispatch(const vector<CaseRun>& runs, size_t lo, size_t hi, size_t other, Jumps& arms) {
+	if (lo == hi) {
+		jumpTable(runs[lo], other, arms);
+		return;
+	}
+
+	const auto mid = lo + (hi - lo + 1) / 2;
+	emit(OpCode::Dup);
+	emit(OpCode::Push, 0, runs[mid].first->first);
+	emit(OpCode::LT);
+	const auto jmp_pc = emit(OpCode::JNEQ);			// selector >= the middle run
+
+	dispatch(runs, lo, mid - 1, other, arms);
+	patch({ jmp_pc }, code->size());
+	dispatch(runs, mid, hi, other, arms);
+}
+
+/**
+ * "case" expr "of" [ case-arm { ";" case-arm } ] [ "else" stmt ] "end"
+ *
+ * @param	level	The current block level
+ * @return	The case statement
+ */
+StmtNode* Comp::caseStmt(int level) {
+	auto n = arena.make<CaseNode>();
+	n->selector = expression(level);
+	if (Datum::Kind::Integer != n->selector->kind)
+		error("case selector is not an integer");
+	expect(Token::Of);
+
+	static constexpr Token::KindSet stops { Token::Else, Token::End };
+
+	set<Datum::Integer> seen;						// Labels so far
+	CaseArm** tail = &n->arms;
+	do {
+		if (oneOf(stops))
+			break;
+
+		vector<Datum::Integer> labels;
+		do {
+			const auto label = caseLabel();
+			if (!seen.insert(label).second)
+				error("duplicate case label", to_string(label));
+			labels.push_back(label);
+		} while (accept(Token::Comma));
+
+		auto arm = *tail = arena.make<CaseArm>();
+		tail = &arm->next;
+		arm->nLabels = labels.size();
+		arm->labels = arena.array<Datum::Integer>(labels.size());
+		copy(labels.begin(), labels.end(), arm->labels);
+
+		expect(Token::Colon);
+		arm->body = statement(level);
+		arm->line = ts.current().line;
+	} while (accept(Token::SemiColon));
+
+	if ((n->hasElse = accept(Token::Else)))
+		n->otherwise = statement(level);
+	expect(Token::End);
+
+	return n;
+}
+
+/**
+ * Moves the statements of a case statement aside, emits the dispatch on the selector, and then
+ * puts the statements back, adjusting their addresses for the dispatch.
+ *
+ * @param	start	The address of the first statement, following the selector
+ * @param	labels	The case labels, and the address of their statements
+ * @param	other	The address of the else statement, or the end of the case statement
+ */
+void Comp::caseDispatch(size_t start, const CaseLabels& labels, size_t other) {
+	// Move the statements aside, and split the labels into runs...
+
+	const InstrVector stmts(code->begin() + start, code->end());
+	const SourceIndex lines(indextbl.begin() + start, indextbl.end());
+	code->resize(start);
+	indextbl.resize(start);
+	logic = Logical();
+
+	vector<CaseRun> runs;
+	for (auto it = labels.cbegin(); it != labels.cend(); ++it) {
+		const long long size = runs.empty() ? 0 : static_cast<long long>(it->first) - runs.back().first->first + 1;
+		const long long count = runs.empty() ? 0 : distance(runs.back().first, it) + 1;
+		if (runs.empty() || size > 2 * count || size > static_cast<long long>(maxTable))
+			runs.push_back({ it, it });
+		else
+			runs.back().second = it;
+	}
+
+	// Emit the dispatch, and then the statements, adjusting addresses for the dispatch
+
+	Jumps arms;
+	if (runs.empty()) {
+		emit(OpCode::JTab, 0, 0);
+		arms.push_back(emit(OpCode::Jump, 0, other));
+	} else
+		dispatch(runs, 0, runs.size() - 1, other, arms);
+
+	const auto delta = code->size() - start;
+	for (auto pc = start; pc < code->size(); ++pc)	// Listed with the selector
+		indextbl[pc] = indextbl[start - 1];
+	for (auto pc : arms)
+		(*code)[pc].addr = (*code)[pc].addr.uinteger() + delta;
+
+	for (size_t i = 0; i < stmts.size(); ++i) {
+		auto instr = stmts[i];
+		if (isBranch(instr.op) && instr.addr.uinteger() >= start)
+			instr.addr = instr.addr.uinteger() + delta;
+		code->push_back(instr);
+		indextbl.push_back(lines[i]);
+	}
+}
 
 /**
  *  stmt { ";" stmt }
  * @param	level		The current block level.
+ * @return	The statements, if any
  */
-void Comp::statementList(int level) {
+StmtNode* Comp::statementList(int level) {
+	StmtNode* list = nullptr;
+	StmtNode** tail = &list;
+
 	do {
-		statement(level);
+		if (auto stmt = statement(level)) {
+			*tail = stmt;
+			tail = &stmt->next;
+		}
 	} while (accept(Token::SemiColon));
+
+	return list;
 }
 
 /**
  * @param	level	The current block level.
+ * @return	The statement, or null if there isn't one
  */
-void Comp::statement(int level) {
+StmtNode* Comp::statement(int level) {
 	if (accept(Token::Identifier, false)) 			// assignment or proc call
-		identStmt(level);
+		return identStmt(level);
 
 	else if (accept(Token::Begin)) {				// begin ... end
-		statementList(level);
+		auto n = arena.make<CompoundNode>();
+		n->body = statementList(level);
 		expect(Token::End);
+		return n;
 
 	} else if (accept(Token::If)) 					// if expr...
-		ifStmt(level);
+		return ifStmt(level);
 
 	else if (accept(Token::While))					// "while" expr...
-		whileStmt(level);
+		return whileStmt(level);
 
 	else if (accept(Token::Repeat))					// "repeat" until...
-		repeatStmt(level);
+		return repeatStmt(level);
 
-	// else: nothing
+	else if (accept(Token::Case))					// "case" expr "of"...
+		return caseStmt(level);
+
+	else if (accept(Token::For))					// "for" ident "=" expr "to"...
+		return forStmt(level);
+
+	return nullptr;									// else: nothing
 }
 
 /**
@@ -714,22 +1140,17 @@ void Comp::statement(int level) {
  * @return 	the next identifer in the token stream, "unknown" if the next token wasn't an
  *  		identifier.
  */
-std::string Comp::nameDecl(int level) {
-	const string id = ts.current().string_value;			// Copy the identifer
+Interner::Id Comp::nameDecl(int level) {
+	const auto id = ts.current().symbol;					// Note the identifer
 
 	if (expect(Token::Identifier)) {						// Consume the identifier
-		auto range = symtbl.equal_range(id);				// Already defined?
-		for (auto it = range.first; it != range.second; ++it) {
-			if (it->second.level() == level) {
-				error("identifier previously defined", id);
-				break;
-			}
-		}
+		if (symtbl.find(id, level) != symtbl.end())			// Already defined?
+			error("identifier previously defined", id);
 
 		return id;
 	}
 
-	return "unknown";
+	return ts.names().intern("unknown");
 }
 
 /**
@@ -759,7 +1180,7 @@ Datum::Kind Comp::typeDecl() {
  */
 void Comp::constDeclBlock(int level) {
 	// Stops if the ';' if followd by any of hte following tokens
-	static const Token::KindSet stops {
+	static constexpr Token::KindSet stops {
 		Token::VarDecl,
 		Token::ProcDecl,
 		Token::FuncDecl,
@@ -805,7 +1226,7 @@ void Comp::constDecl(int level) {
 		// Insert ident into the symbol table
 		symtbl.insert(	{ ident, SymValue(level, number)	}	);
 		if (verbose)
-			cout << progName << ": constDecl " << ident << ": " << level << ", " << number << "\n";
+			cout << progName << ": constDecl " << ts.names().name(ident) << ": " << level << ", " << number << "\n";
 
 	} else if (accept(Token::RealNum, false)) {
 		const Datum number(ts.current().real_value);
@@ -814,7 +1235,7 @@ void Comp::constDecl(int level) {
 		/// Insert ident into the symbol table
 		symtbl.insert(	{	ident, SymValue(level, number)	}	);
 		if (verbose)
-			cout << progName << ": constDecl " << ident << ": " << level << ", " << number << "\n";
+			cout << progName << ": constDecl " << ts.names().name(ident) << ": " << level << ", " << number << "\n";
 
 	} else if (accept(Token::Identifier, false)) {
 		auto it = identRef();
@@ -825,7 +1246,7 @@ void Comp::constDecl(int level) {
 				if (verbose)
 					cout
 						<< progName << ": constDecl "
-						<< ident << ": " << level << ", "
+						<< ts.names().name(ident) << ": " << level << ", "
 						<< it->second.value() << "\n";
 				break;
 
@@ -843,7 +1264,7 @@ void Comp::constDecl(int level) {
 		}
 
 	} else {
-		error("expected an interger or real literal, got neither", ts.current().string_value);
+		error("expected an interger or real literal, got neither", string(ts.current().text));
 		next();
 	}
 }
@@ -889,7 +1310,7 @@ int Comp::varDeclBlock(int level) {
  */
 void Comp::varDeclList(int level, bool params, NameKindVec& idents) {
 	// Stops if the ';' if followd by any of hte following tokens
-	static const Token::KindSet stops {
+	static constexpr Token::KindSet stops {
 		Token::ProcDecl,
 		Token::FuncDecl,
 		Token::Begin,
@@ -907,7 +1328,7 @@ void Comp::varDeclList(int level, bool params, NameKindVec& idents) {
 	for (const auto& id : idents) {
 		if (verbose)
 			cout << progName  
-				 << ": var/param " 	<< id.name << ": " 
+				 << ": var/param " 	<< ts.names().name(id.name) << ": " 
 				 << level 			<< ", "
 			     << dx	 			<< ", " 
 				 << Datum::toString(id.kind) << "\n";
@@ -934,7 +1355,7 @@ void Comp::varDeclList(int level, bool params, NameKindVec& idents) {
  * @param[in,out]	idents	Vector of identifer, kind pairs
  */
 void Comp::varDecl(int level, NameKindVec& idents) {
-	vector<string> indentifiers;
+	vector<Interner::Id> indentifiers;
 
 	// Find and append comma separated identifiers to the list...
 	do {
@@ -952,23 +1373,25 @@ void Comp::varDecl(int level, NameKindVec& idents) {
  *
  * ident "(" [ name { "," name } ] ")" ...
  *
- * @param	level	The current block level.
- * @param 	kind	The type of subroutine, e.g., procedure or fuction
+ * @param		level	The current block level.
+ * @param 		kind	The type of subroutine, e.g., procedure or fuction
+ * @param[out]	ident	The subroutines name
  * @return	subrountine's symbol table entry
  */
-SymValue& Comp::subPrefixDecl(int level, SymValue::Kind kind) {
+SymValue& Comp::subPrefixDecl(int level, SymValue::Kind kind, Interner::Id& ident) {
 	SymbolTable::iterator	it;				// Will point to the new symbol table entry...
 
-	const auto& ident = nameDecl(level);	// insert the name into the symbol table
+	ident = nameDecl(level);				// insert the name into the symbol table
 	it = symtbl.insert( { ident, SymValue(kind, level)	} );
 	if (verbose)
-		cout << progName << ": subrountine-decl " << ident << ": " << level << ", 0\n";
+		cout << progName << ": subrountine-decl " << ts.names().name(ident) << ": " << level << ", 0\n";
 
 	// Process the formal auguments, if any...
 	expect(Token::OpenParen);
 
 	// Note that the activation fram elevel is that of the *following* block!
 
+	symtbl.enter();				// The parameters are in the block's scope
 	NameKindVec	idents;				// vector of name/type pairs.
 	varDeclList(level+1, true, idents);
 	expect(Token::CloseParen);
@@ -984,8 +1407,9 @@ SymValue& Comp::subPrefixDecl(int level, SymValue::Kind kind) {
  * @param	level	The current block level.
  */
 void Comp::procDecl(int level) {
-	auto& val = subPrefixDecl(level, SymValue::Kind::Procedure);
-	blockDecl(val, level + 1);
+	Interner::Id ident;
+	auto& val = subPrefixDecl(level, SymValue::Kind::Procedure, ident);
+	blockDecl(ts.names().name(ident), val, level + 1);
 	expect(Token::SemiColon);				// procedure declarations end with a ';'!
 }
 
@@ -994,9 +1418,10 @@ void Comp::procDecl(int level) {
  * @param	level	The current block level.
  */
 void Comp::funcDecl(int level) {
-	auto& val = subPrefixDecl(level, SymValue::Kind::Function);
+	Interner::Id ident;
+	auto& val = subPrefixDecl(level, SymValue::Kind::Function, ident);
 	val.type(typeDecl());
-	blockDecl(val, level + 1);
+	blockDecl(ts.names().name(ident), val, level + 1);
 	expect(Token::SemiColon);	// function declarations end with a ';'!
 }
 
@@ -1030,59 +1455,91 @@ void Comp::subrountineDecls(int level) {
  *         	 | function ident "(" [ ident { "," ident } ] ")" block ";" }
  *          stmt ;
  *
+ * The block is appended to the enclosing block's subroutines, if any, and noted, by the value of
+ * it's symbol, so that calls refer to it. Unless the whole program is generated once it's been
+ * parsed, the block's code is generated as soon as it's been parsed.
+ *
+ * @param	name	The blocks (procedures) name
  * @param	val		The blocks (procedures) symbol table entry value
  * @param	level	The current block level.
- * @return 	Entry point address
+ * @return 	The block
  */
-Datum::Unsigned Comp::blockDecl(SymValue& val, int level) {
-	constDeclBlock(level);						// declaractions...
-	auto dx = varDeclBlock(level);
-	subrountineDecls(level);
+BlockNode* Comp::blockDecl(const char* name, SymValue& val, int level) {
+	auto n = arena.make<BlockNode>();
+	n->name = name;
+	n->level = level;
+	n->nParams = val.params().size();
+	n->function = SymValue::Kind::Function == val.kind();
+	n->entry = val.value();						// Until it's generated
+
+	val.value(blocks.size());
+	blocks.push_back(n);
+
+	if (curblock) {
+		auto tail = &curblock->subs;
+		while (*tail)
+			tail = &(*tail)->next;
+		*tail = n;
+	}
 
-	/* Block body
-	 *
-	 * Emit the block's prefix, saving and return its address, followed by the postfix. Omit the prefix
-	 * if dx == 0 (the subroutine has zero locals.
-	 */
+	const auto parent = curblock;
+	curblock = n;
+	if (!tree)
+		gen->enter(*n);
 
-	const auto addr = dx > 0 ? emit(OpCode::Enter, 0, dx) : code->size();
-	val.value(addr);
+	constDeclBlock(level);						// declaractions...
+	n->locals = varDeclBlock(level);
+	subrountineDecls(level);
 
+	n->enterLine = ts.current().line;
 	if (expect(Token::Begin)) {					// "begin" statements... "end"
-		statementList(level);
+		n->body = statementList(level);
 		expect(Token::End);
 	}
+	n->exitLine = ts.current().line;
+	if (!tree)
+		gen->leave(*n);
 
-	// block postfix... TBD; emit reti or retr for functions!
+	purge();									// Remove symbols only visible at this level
+	curblock = parent;
 
-	const auto sz = val.params().size();
-	if (SymValue::Kind::Function == val.kind())
-		emit(OpCode::Retf, 0, sz);	// function...
-	else
-		emit(OpCode::Ret, 0, sz);	// procedure...
-
-	purge(level);								// Remove symbols only visible at this level
-
-	return addr;
+	return n;
 }
 
 void Comp::run() {
 	next();										// Fetch the 1st token
-	auto range = symtbl.equal_range("main");
-	assert(range.first != range.second);
+	auto it = symtbl.find(ts.names().intern("main"));
+	assert(it != symtbl.end());
+
+	CodeGen cg(*this);
+	gen = &cg;
+	cg.prologue(ts.current().line);
 
-	// Emit a call to the main procedure, followed by a halt
-	const auto call_pc = emit(OpCode::Call, 0, 0);
-	emit(OpCode::Halt);
+	symtbl.enter();
+	auto main = blockDecl("main", it->second, 0);
+	expect(Token::Period);
 
-	// emit the first block (block 0)
+	if (tree)									// Generate the whole program, now that it's parsed
+		main->accept(cg);
+	cg.epilogue(*main);
+	gen = nullptr;
 
-	const auto addr = blockDecl(range.first->second, 0);
-	if (verbose)
-		cout << progName << ": patching call to main at " << call_pc << " to " << addr  << "\n";
+	arena.clear();								// Free the AST, all at once
+	blocks.clear();
+}
 
-	(*code)[call_pc].addr = addr;
-	expect(Token::Period);
+/// Compile, and then optimize the results if there aren't any errors...
+void Comp::compile() {
+	if (0 == passes)
+		run();
+
+	else {
+		passes->time("compile", *code, [this] { run(); });
+		if (0 == nErrors) {
+			Program prog { *code, indextbl, subrs };
+			(*passes)(prog);
+		}
+	}
 }
 
 // public:
@@ -1091,41 +1548,55 @@ void Comp::run() {
  * Construct a new compilier with the token stream initially bound to std::cin.
  * @param	pName	The prefix string used by error and verbose/diagnostic messages.
  */
-Comp::Comp(const string& pName) : progName {pName}, nErrors{0}, verbose {false}, ts{cin} {
-	symtbl.insert({"main", SymValue(SymValue::Kind::Procedure, 0)});	// Install the "main" rountine declaraction
+Comp::Comp(const string& pName)
+	: progName {pName}, nErrors{0}, verbose {false}, ts{cin}, code{0}, cursubr{-1}, passes{0},
+	  tree{false}, curblock{nullptr}, gen{nullptr}
+{
+	symtbl.insert({ts.names().intern("main"), SymValue(SymValue::Kind::Procedure, 0)});	// Install the "main" rountine declaraction
 }
 
 /**
+ * If the compile is successful, and pm isn't null, the code is optimized by pm before the listing
+ * is written. The compile itself is timed by pm.
+ *
+ * The listing is written from the source retained by the token stream, so the source is only
+ * read once, even from the standard input stream.
+ *
  * @param	inFile	The source file name, where "-" means the standard input stream
  * @param	prog	The generated machine code is appended here
  * @param	verb	Output verbose messages if true
+ * @param	pm		The optimization passes, or null
+ * @param	list	Where to write the listing, or null for no listing
+ * @param	pipe	Scan the source on a separate thread if true
+ * @param	ast		Generate code once the whole program has been parsed, rather than a block at a
+ *					time
  * @return	The number of errors encountered
  */
-unsigned Comp::operator()(const string& inFile, InstrVector& prog, bool verb) {
+unsigned Comp::operator()(	const string&	inFile,
+							InstrVector&	prog,
+							bool			verb,
+							PassManager*	pm,
+							ostream*		list,
+							bool			pipe,
+							bool			ast) {
 	code = &prog;
 	verbose = verb;
+	passes = pm;
+	tree = ast;
 
-	if ("-" == inFile)  {						// "-" means standard input
+	bool opened = true;
+	ts.keep(0 != list);
+	ts.pipeline(pipe);
+	if ("-" == inFile)							// "-" means standard input
 		ts.set_input(cin);
-		run();
 
-		// Just disasmemble as we can't rewind standard input!
-		for (unsigned loc = 0; loc < code->size(); ++loc)
-			disasm(cout, loc, (*code)[loc]);
+	else if (!(opened = ts.open(inFile)))
+		error("error opening source file", inFile);
 
-	} else {
-		ifstream ifile(inFile);
-		if (!ifile.is_open())
-			error("error opening source file", inFile);
-
-		else {
-			ts.set_input(ifile);
-			run();
-
-			ifile.close();						// Rewind the source (seekg(0) isn't working!)...
-			ifile.open(inFile);
-			listing(inFile, ifile, cout);		// 	create a listing...
-		}
+	if (opened) {
+		compile();
+		if (list)
+			listing(inFile, ts.source(), *list);	// 	create a listing...
 	}
 	code = 0;
 
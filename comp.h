@@ -9,12 +9,18 @@
 #ifndef	COMP_H
 #define	COMP_H
 
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
+#include <string_view>
 #include <utility>
 
+#include "arena.h"
+#include "ast.h"
 #include "instr.h"
 #include "datum.h"
+#include "pass.h"
 #include "token.h"
 #include "symbol.h"
 
@@ -23,8 +29,13 @@
  * A recursive decent compilier, evolved from
  * https://en.wikipedia.org/wiki/Recursive_descent_parser#C_implementation. Construction binds
  * a program name with the instance, used in error messages. The compilier is run via the call
- * operator which specifies the input stream, the location of the emitted code, and weather to
- * emit a travlelog (verbose messages).
+ * operator which specifies the input stream, the location of the emitted code, weather to
+ * emit a travlelog (verbose messages), and optionally, the PassManager that optimizes the code
+ * before the listing is written, and where to write the listing, if anywhere.
+ *
+ * The productions build an abstract syntax tree, allocated from an arena, that a CodeGen
+ * generates code from; each block as soon as it's been parsed, or, if asked to, the whole
+ * program once it's been parsed. The arena is freed once the code has been generated.
  *
  * @section grammer Grammer (EBNF)
  *
@@ -52,8 +63,14 @@
  *                          'if' cond 'then' stmt { 'else' stmt }  |
  *                          'while' cond 'do' stmt                 |
  *                          'repeat' stmt 'until' cond             |
+ *                          'case' expr 'of' case-lst 'end'        |
+ *                          'for' ident '=' expr 'to' expr
+ *                              [ 'step' expr ] 'do' stmt          |
  *                          stmt-blk ]
  *                       ;
+ *              case-lst: [ case-arm { ';' case-arm } ] [ 'else' stmt ] ;
+ *              case-arm: case-label { ',' case-label } ':' stmt ;
+ *            case-label: [ '-' ] integer | ident ;
  *            const-expr: number | ident ;
  *              expr-lst: expr { ',' expr } ;
  *                  expr: simple-expr { relo-op simple-expr } ;
@@ -79,15 +96,23 @@
  */
 class Comp {
 public:
+	static const size_t	maxSelect = 8;		///< Largest value expression that an if may select
+	static const size_t	maxTable = 256;		///< Largest case jump table
+
 	Comp(const std::string& pName);			///< Constructor; use pName for error messages
 	virtual ~Comp() {}						///< Destructor
 
 	/// Run the compiler
-	unsigned operator()(const std::string& inFile, InstrVector& prog, bool verb = false);
+	unsigned operator()(	const std::string&	inFile,
+							InstrVector&		prog,
+							bool				verb = false,
+							PassManager*		pm = 0,
+							std::ostream*		list = 0,
+							bool				pipe = false,
+							bool				ast = false);
 
 private:
-	/// A table, indexed by instruction address, yeilding source line numbers
-	typedef std::vector<unsigned> SourceIndex;
+	friend class CodeGen;
 
 	std::string			progName;			///< The compilier's name, used in error messages
 	unsigned			nErrors;			///< Total # of compilier errors
@@ -96,26 +121,68 @@ private:
 	SymbolTable			symtbl;				///< Symbol table
 	InstrVector*		code;				///< Emitted code
 	SourceIndex			indextbl;			///< Source cross-index for listings
+	SubrVector			subrs;				///< Compiled subroutines, main first
+	int					cursubr;			///< Index of the subroutine being compiled
+	PassManager*		passes;				///< Optimization passes, if any
+	bool				tree;				///< Generate code once the whole program's been parsed?
+	Arena				arena;				///< The AST's nodes
+	std::vector<BlockNode*> blocks;			///< Parsed blocks, indexed by their symbol's value
+	BlockNode*			curblock;			///< The block being parsed
+	CodeGen*			gen;				///< Generates code from the AST, while running
 
 protected:
 	/// Name, kind pair
 	struct NameKind {
-		std::string		name;				///< Variable/parameter
+		Interner::Id	name;				///< Variable/parameter
 		Datum::Kind		kind;				///< It's kind
 
 		/// Construct a name/kind pair
-		NameKind(const std::string n, Datum::Kind k) : name{n}, kind{k} {}
+		NameKind(Interner::Id n, Datum::Kind k) : name{n}, kind{k} {}
 	};
 
 	/// A vector of name kind pairs
 	typedef std::vector<NameKind>	NameKindVec;
 
+	/// Addresses of branches awaiting their target
+	typedef std::vector<size_t>		Jumps;
+
+	/// Case labels, and the address of their statements
+	typedef std::map<Datum::Integer, size_t>	CaseLabels;
+
+	/// A run of case labels, first..last, dense enough for a jump table
+	typedef std::pair<CaseLabels::const_iterator, CaseLabels::const_iterator>	CaseRun;
+
+	/** A short-circuit logical operation, e.g., a && b
+	 *
+	 * Each operand branches to the tail when its value decides the result; the tail, push !value,
+	 * jump over, push value, materializes the result. Conditions drop the tail, and branch on the
+	 * operands directly.
+	 */
+	struct Logical {
+		Jumps			jumps;				///< Branches, but the last operand's, to the tail
+		size_t			tail;				///< Address of the tail
+		size_t			end;				///< Address following the tail, zero if none
+		size_t			mark;				///< Address of the last operand's branch
+		bool			value;				///< The operands branch if their value is value
+
+		/// The last operand, if it's also a logical operation
+		std::shared_ptr<Logical>	last;
+
+		/// Construct an empty operation
+		Logical() : tail{0}, end{0}, mark{0}, value{false} {}
+	};
+
+	Logical				logic;				///< The last logical operation emitted
+
 	void error(const std::string& msg);		///< Write an error message...
 
 	/// Write an error message...
 	void error(const std::string& msg, const std::string& name);
 
-	Token next();							///< Read and return the next token...
+	/// Write an error message with an identifier...
+	void error(const std::string& msg, Interner::Id name);
+
+	const Token& next();							///< Read and return the next token...
 
 	/// Return the current token kind..
 	Token::Kind current() 					{	return ts.current().kind;	}
@@ -126,48 +193,79 @@ protected:
 	/// Expect the next token to be a k...
 	bool expect(Token::Kind k, bool get = true);
 
-	bool oneOf(Token::KindSet set);			///< Is the current token one of the given set?
+	bool oneOf(const Token::KindSet& set);			///< Is the current token one of the given set?
 
 	/// Emit an instruction...
 	size_t emit(const OpCode op, int8_t level = 0, Datum addr = 0);
 
+	/// Patch branches to a target address...
+	void patch(const Jumps& jumps, size_t addr);
+
+	bool chained() const;					///< Is the last value emitted a logical operation?
+	Jumps branch(bool when);				///< Branch if the value is when...
+
+	/// Branch on a logical operations value...
+	Jumps branch(const Logical& l, bool when);
+
+	void truth(Datum::Kind kind);			///< Convert a real operand to its truth value...
+
 	/// Promote data type if necessary...
 	Datum::Kind promote (Datum::Kind lhs, Datum::Kind rhs);
 
-	/// Promote assigned data type if necessary...
-	void assignPromote (Datum::Kind lhs, Datum::Kind rhs);
-
 	/// Create a listing...
-	void listing(const std::string& name, std::istream& source, std::ostream& out);
+	void listing(const std::string& name, std::string_view source, std::ostream& out);
 
-	/// Purge symtbl of entries from a given block level
-	void purge(int level);
+	/// Purge symtbl of the current block's entries
+	void purge();
 
-	/// Emit a variable reference, e.g., an absolute address...
-	Datum::Kind emitVarRef(int level, const SymValue& val);
+	/// Emit a reference to the variable at offset, depth levels down...
+	void emitVarRef(int depth, Datum::Integer offset);
 
 	SymbolTable::iterator identRef();		///< identifier sub-production...
-	Datum::Kind identifier(int level);		///< factor-identifier production...
-	Datum::Kind factor(int level);			///< factor production...
-	Datum::Kind term(int level);			///< terminal production...
-	Datum::Kind unary(int level);			///< unary-expr sub-production...
-	Datum::Kind simpleExpr(int level);		///< simple-expr production...
-	Datum::Kind expression(int level);		///< expression production...
+	ExprNode* identifier(int level);		///< factor-identifier production...
+	ExprNode* factor(int level);			///< factor production...
+
+	/// short-circuit logical operation...
+	ExprNode* logical(ExprNode* lhs, int level, Token::Kind op);
+
+	ExprNode* term(int level);				///< terminal production...
+	ExprNode* unary(int level);				///< unary-expr sub-production...
+	ExprNode* simpleExpr(int level);		///< simple-expr production...
+	ExprNode* expression(int level);		///< expression production...
 
 	/// assignment-statement production...
-	void assignStmt(const std::string& name, const SymValue& val, int level);
+	StmtNode* assignStmt(Interner::Id name, const SymValue& val, int level);
 
 	/// call-statement production...
-	void callStmt(const std::string& name, const SymValue& val, int level);
+	CallNode* callStmt(Interner::Id name, const SymValue& val, int level);
+
+	StmtNode* identStmt(int level);			///< identifier-statement production...
+	StmtNode* whileStmt(int level);			///< while-statement production...
+	StmtNode* repeatStmt(int level);		///< repeat-statement production...
+	StmtNode* forStmt(int level);			///< for-statement production...
+	StmtNode* ifStmt(int level);			///< if-statement production...
+
+	/// Are the instructions from..to a value expression that an if may select?
+	bool selectable(size_t from, size_t to) const;
+
+	/// Convert an if-else of assignments to a Select...
+	bool select(size_t then_pc, size_t else_pc);
+	Datum::Integer caseLabel();				///< case-label production...
+	StmtNode* caseStmt(int level);			///< case-statement production...
+
+	/// Emit a jump table for a run of case labels...
+	void jumpTable(const CaseRun& run, size_t other, Jumps& arms);
+
+	/// Emit a decision tree over runs of case labels...
+	void dispatch(const std::vector<CaseRun>& runs, size_t lo, size_t hi, size_t other, Jumps& arms);
+
+	/// Move a case statement's statements after it's dispatch...
+	void caseDispatch(size_t start, const CaseLabels& labels, size_t other);
 
-	void identStmt(int level);				///< identifier-statement production...
-	void whileStmt(int level);				///< while-statement production...
-	void repeatStmt(int level);				///< repeat-statement production...
-	void ifStmt(int level);					///< if-statement production...
-	void statement(int level);				///< statement production...
-	void statementList(int level);			///< statement-list-production...
+	StmtNode* statement(int level);			///< statement production...
+	StmtNode* statementList(int level);		///< statement-list-production...
 
-	std::string nameDecl(int level);		///< name (identifier) check...
+	Interner::Id nameDecl(int level);		///< name (identifier) check...
 	Datum::Kind typeDecl();					///< type decal production...
 
 	void constDeclBlock(int level);			///< const-declaration-block production...
@@ -182,16 +280,17 @@ protected:
 	void varDecl(int level, NameKindVec& idents);		///< ariable-declaration production...
 
 	/// Subroutine-declaration production...
-	SymValue& subPrefixDecl(int level, SymValue::Kind kind);
+	SymValue& subPrefixDecl(int level, SymValue::Kind kind, Interner::Id& ident);
 
 	void procDecl(int level);				///< procedure-declaration production...
 	void funcDecl(int level);				///< function-declaration production...
 	void subrountineDecls(int level);		///< function/procedue declaraction productions...
 
 	/// block-declaration production...
-	Datum::Unsigned blockDecl(SymValue& val, int level);
+	BlockNode* blockDecl(const char* name, SymValue& val, int level);
 
 	void run();								///< runs the compilier...
+	void compile();							///< runs, and then optimizes...
 };
 
 #endif
@@ -0,0 +1,19 @@
+{ Conversions of constants are made by the compiler, and the	}
+{ conversions of variables a loop doesn't write are hoisted out	}
+{ of the loop, at -O2											}
+var i, n : integer; x, sum : real;
+
+begin
+	n = 3;
+	x = 2;
+	sum = 0;
+	i = 0;
+	while i < 5 do begin
+		sum = sum + n * x + 2 * x;
+		i = i + 1
+	end;
+
+	sum = 0;
+	for i = 1 to 5 do					{ fornext writes i, n is invariant	}
+		sum = sum + i + n				{ s/b 30							}
+end.
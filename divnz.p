@@ -0,0 +1,28 @@
+{ Divisions by a nonzero constant, or by a variable whose range	}
+{ excludes zero, don't check the divisor at -O2					}
+var total : integer;
+
+procedure harmonic(n : integer)
+	var i, sum : integer;
+	begin
+		sum = 0;
+		i = 1;
+		while i <= n do begin
+			sum = sum + 1000 / i;
+			i = i + 1
+		end;
+		total = sum / n + sum % 7
+	end;
+
+procedure countdown(n : integer)
+	begin
+		while n > 0 do begin
+			total = total + 100 / n;
+			n = n - 1
+		end
+	end;
+
+begin
+	harmonic(5);
+	countdown(3)
+end.
@@ -13,7 +13,8 @@
  *
  * Like PL/0, PL/0C is a combination compiler and interpreter; it first runs the compiler
  * (Comp), and if no errors where encountered, it runs the results in the interpreter
- * (Interp). A listing and machine output are written to standard output.
+ * (Interp). A listing and machine output are written to standard output; the listing may be
+ * written to a file instead, or omitted.
  *
  * The compiler started life as a copy of the C example at
  * https://en.wikipedia.org/wiki/Recursive_descent_parser, modified to emit code per Wirth's
@@ -62,8 +63,12 @@
 
 #include "comp.h"
 #include "interp.h"
+#include "opt.h"
+#include "pass.h"
 
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <vector>
 
 using namespace std;
@@ -71,6 +76,13 @@ using namespace std;
 static	string	progName;						///< This programs name
 static 	string	inputFile {"-"};				///< Source file name, or - for standard input
 static 	bool	verbose = false;				///< Verbose messages if true
+static	unsigned optLevel = 0;					///< Optimization level; 0, 1 or 2
+static	bool	timePasses = false;				///< Report pass times if true
+static	unsigned unrollFactor = 4;				///< Loop unroll factor, at -O2
+static	string	listFile;						///< Listing file name, or empty for standard output
+static	bool	noListing = false;				///< Omit the listing if true
+static	bool	pipeline = false;				///< Scan on a separate thread if true
+static	bool	buildAst = false;				///< Generate code from the whole AST if true
 
 /// Print a usage message on standard error output
 static void help() {
@@ -78,6 +90,18 @@ static void help() {
 		 << "Where options is zero or more of the following:\n"
 		 << "-?        Print this message and exit.\n"
 		 << "-help     Same as -?\n"
+		 << "-ast      Parse the whole program, and then generate code from it.\n"
+		 << "-list=file\n"
+		 << "          Write the listing to file, rather than standard output.\n"
+		 << "-no-list  Don't write a listing.\n"
+		 << "-O0       Don't optimize (default).\n"
+		 << "-O1       Cheap, local, optimizations.\n"
+		 << "-O2       -O1, plus whole subroutine and interprocedural optimizations.\n"
+		 << "-pipeline Scan the source on a separate thread, overlapping compilation.\n"
+		 << "-time-passes\n"
+		 << "          Report the time taken, and instruction counts, of each compiler pass.\n"
+		 << "-unroll=n Unroll counted loops n times at -O2; 4 by default, 1 disables, and\n"
+		 << "          at most " << LoopUnroll::maxFactor << ".\n"
 		 << "-verbose  Set verbose mode.\n"
 		 << "-v        Same as -verbose.\n"
  		 << "-version  Print the program version.\n"
@@ -113,7 +137,38 @@ static bool parseCommandline(const vector<string>& args) {
 		else if ("-version" == arg)
 			printVersion();
 
-		else if ('-' == arg[0])	{				// parse -options...
+		else if ("-time-passes" == arg)
+			timePasses = true;
+
+		else if ("-no-list" == arg)
+			noListing = true;
+
+		else if ("-pipeline" == arg)
+			pipeline = true;
+
+		else if ("-ast" == arg)
+			buildAst = true;
+
+		else if (0 == arg.compare(0, 6, "-list=")) {
+			listFile = arg.substr(6);
+			if (listFile.empty()) {
+				cerr << progName << ": missing listing file name: " << arg << "\n";
+				return false;
+			}
+
+		} else if ("-O0" == arg || "-O1" == arg || "-O2" == arg)
+			optLevel = arg[2] - '0';
+
+		else if (0 == arg.compare(0, 8, "-unroll=")) {
+			istringstream iss(arg.substr(8));
+			long long factor;					// wide enough to see "-1", rather than wrap it
+			if (!(iss >> noskipws >> factor) || !iss.eof() || factor < 0) {
+				cerr << progName << ": bad unroll factor: " << arg << "\n";
+				return false;
+			}
+			unrollFactor = factor > LoopUnroll::maxFactor ? +LoopUnroll::maxFactor : factor;
+
+		} else if ('-' == arg[0])	{				// parse -options...
 			for (unsigned n = 1; n < arg.size(); ++n)
 				switch(arg[n]) {
 				case '?':
@@ -164,9 +219,25 @@ int main(int argc, char* argv[]) {
 		args.push_back(argv[argn]);
 
 	if (!parseCommandline(args))
-		++nErrors;
-												// Compile the source, run if no errors
-	else if (0 == (nErrors = comp(inputFile, code, verbose))) {
+		return 1;
+
+	ostream*	list = noListing ? 0 : &cout;	// Where to write the listing...
+	ofstream	listStream;
+	if (!noListing && !listFile.empty()) {
+		listStream.open(listFile);
+		if (!listStream.is_open()) {
+			cerr << progName << ": can't open listing file: " << listFile << "\n";
+			return 1;
+		}
+		list = &listStream;
+	}
+
+	PassManager	passes{optLevel, unrollFactor};				// The optimization passes...
+	nErrors = comp(inputFile, code, verbose, &passes, list, pipeline, buildAst);
+	if (timePasses)
+		passes.report(cerr);
+												// Run if no errors
+	if (0 == nErrors) {
 		if (verbose) {
 			if (inputFile == "-")
 				cout << progName << ": loading program from standard input, and starting pl/0c...\n";
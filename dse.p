@@ -0,0 +1,18 @@
+{ Stores that are never read are removed, along with locals	}
+{ that are no longer referenced, at -O2						}
+var result : integer;
+
+procedure compute(n : integer)
+	var unused, scratch, t : integer;
+	begin
+		scratch = 0;
+		unused = n * 2;
+		scratch = n + 1;
+		t = scratch * scratch;
+		result = t;
+		n = 0
+	end;
+
+begin
+	compute(4)
+end.
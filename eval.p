@@ -0,0 +1,25 @@
+{ Calls to functions that only reference their own frame, passing	}
+{ constants, are evaluated by the compiler at -O2					}
+var a, b : integer;
+
+function gcd(x, y : integer) : integer
+	var t : integer;
+	begin
+		while y != 0 do begin
+			t = x % y;
+			x = y;
+			y = t
+		end;
+		gcd = x
+	end;
+
+function fib(n : integer) : integer
+	begin
+		if n < 2 then fib = n else fib = fib(n - 1) + fib(n - 2)
+	end;
+
+begin
+	a = gcd(1071, 462);
+	b = fib(10);
+	a = gcd(a, b)
+end.
@@ -0,0 +1,61 @@
+{ for loops evaluate their limit and step once, and step the loop	}
+{ variable with a single instruction								}
+var i, j, n, sum : integer; rsum : real;
+
+procedure count(lo, hi, by : integer)
+	var k, c : integer;
+	begin
+		c = 0;
+		for k = lo to hi step by do
+			c = c + 1;
+		n = c
+	end;
+
+procedure total()
+	begin
+		sum = 0;
+		for i = 1 to 5 do
+			sum = sum + i				{ i is global; s/b 15	}
+	end;
+
+procedure mixed()
+	var k : integer;
+
+	function twice() : integer
+		begin
+			twice = k * 2				{ only reads k, so it's lifted	}
+		end;
+
+	begin
+		rsum = 0;
+		for i = 1 to 4 do
+			rsum = rsum + i;			{ converts i; s/b 10.0	}
+		sum = 0;
+		for k = 1 to 4 do
+			sum = twice() + sum			{ loops back to the call; s/b 20	}
+	end;
+
+begin
+	sum = 0;
+	n = 3;
+	for i = 1 to n do begin				{ the limit stays 3	}
+		n = n + 1;
+		sum = sum + i
+	end;								{ s/b 6				}
+
+	for i = 10 to 1 step -3 do
+		for j = 0 to i / 4 do
+			sum = sum + j;				{ s/b 11			}
+
+	for i = 1 to 0 do
+		sum = 0;						{ never runs		}
+
+	count(1, 10, 2);					{ s/b 5				}
+	count(5, -5, -5);					{ s/b 3				}
+	total();
+	mixed();
+
+	n = 0;
+	for j = 2147483645 to 2147483647 do
+		n = n + 1						{ never steps past the limit; s/b 3	}
+end.
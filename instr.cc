@@ -36,6 +36,8 @@ const OpCodeInfo::InfoMap OpCodeInfo::opInfoTbl {
 	{ OpCode::Mul,		OpCodeInfo{ "mul",		2			}	},
 	{ OpCode::Div,		OpCodeInfo{ "div",		2			}	},
 	{ OpCode::Rem,		OpCodeInfo{ "rem",		2			}	},
+	{ OpCode::DivNZ,	OpCodeInfo{ "divnz",	2			}	},
+	{ OpCode::RemNZ,	OpCodeInfo{ "remnz",	2			}	},
 
 	{ OpCode::BOR,		OpCodeInfo{ "bor",		2			}	},
 	{ OpCode::BAND,		OpCodeInfo{ "band",		2			}	},
@@ -52,10 +54,12 @@ const OpCodeInfo::InfoMap OpCodeInfo::opInfoTbl {
 
 	{ OpCode::LOR,		OpCodeInfo{ "lor",		2			}	},
 	{ OpCode::LAND,		OpCodeInfo{ "land",		2			}	},
+	{ OpCode::Select,	OpCodeInfo{ "select",	3			}	},
 
 	// Push/pop
 
 	{ OpCode::Push,		OpCodeInfo{ "push",		1			}	},
+	{ OpCode::Dup,		OpCodeInfo{ "dup",		1			}	},
 	{ OpCode::PushVar,	OpCodeInfo{ "pushvar",	1			}	},
 	{ OpCode::Eval,		OpCodeInfo{ "eval",		2			}	},
 	{ OpCode::Assign,	OpCodeInfo{ "assign",	2			}	},
@@ -66,8 +70,13 @@ const OpCodeInfo::InfoMap OpCodeInfo::opInfoTbl {
 	{ OpCode::Enter,	OpCodeInfo{ "enter",	0			}	},	// Size isn't staticly know
 	{ OpCode::Ret,		OpCodeInfo{ "ret",		FrameSize	}	},
 	{ OpCode::Retf,		OpCodeInfo{ "retf",		FrameSize	}	}, 	// Pops frame, push return value
+	{ OpCode::LCall,	OpCodeInfo{ "lcall",	0			}	},
+	{ OpCode::LRet,		OpCodeInfo{ "lret",		LeafFrameSize }	},
 	{ OpCode::Jump,		OpCodeInfo{ "jump",		0			}	},
 	{ OpCode::JNEQ,		OpCodeInfo{ "jneq",		0			}	},
+	{ OpCode::JTab,		OpCodeInfo{ "jtab",		1			}	},
+	{ OpCode::ForTest,	OpCodeInfo{ "fortest",	3			}	},
+	{ OpCode::ForNext,	OpCodeInfo{ "fornext",	3			}	},
 
 	{ OpCode::Halt,		OpCodeInfo{ "halt",		0			}   }
 };
@@ -112,6 +121,10 @@ Datum::Unsigned disasm(ostream& out, Datum::Unsigned loc, const Instr& instr, co
 	case OpCode::Enter:
 	case OpCode::Jump:
 	case OpCode::JNEQ:
+	case OpCode::JTab:
+	case OpCode::ForTest:
+	case OpCode::ForNext:
+	case OpCode::LCall:
 		out << " " << instr.addr;
 		break;
 
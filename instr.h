@@ -29,6 +29,19 @@ enum Frame {
 	FrameSize							///< Number of entries in an activaction frame (4)
 };
 
+/** Leaf Activation Frame layout
+ *
+ * Word offsets from the start of a leaf activation frame, as created by OpCode::LCall. Leaf
+ * procedures never reference another frame, or return a value, so their frames omit the
+ * static link and return value.
+ */
+enum LeafFrame {
+	LeafFrameOldFp		= 0,			///< Offset to the saved frame pointer register
+	LeafFrameRetAddr	= 1,			///< Offset to the return address
+
+	LeafFrameSize						///< Number of entries in a leaf activation frame (2)
+};
+
 /// Operation codes; restricted to 256 operations, maximum
 enum class OpCode : unsigned char {
 	Not, 								///< Unary boolean not
@@ -44,6 +57,8 @@ enum class OpCode : unsigned char {
 	Mul,								///< Multiplication
 	Div,								///< Division
 	Rem,								///< Remainder
+	DivNZ,								///< Division by a divisor known to be nonzero
+	RemNZ,								///< Remainder by a divisor known to be nonzero
 
 	BOR,								///< Bitwise inclusive or
 	BAND,								///< Bitwise and
@@ -61,8 +76,10 @@ enum class OpCode : unsigned char {
 
 	LOR,								///< Logical or
 	LAND,								///< Integer logical and
+	Select,								///< Condition, then value, else value; push one of the values
 	
 	Push,								///< Push a constant integer value
+	Dup,								///< Push a copy of TOS
 	PushVar,							///< Push variable address (base(level) + addr)
 	Eval,								///< Evaluate variable TOS = address, replace with value
 	Assign,								///< Assign; TOS = variable address, TOS-1 = value
@@ -71,8 +88,13 @@ enum class OpCode : unsigned char {
 	Enter,								///< Allocate locals on the stack
 	Ret,								///< Return from procedure; unlink Frame
 	Retf,								///< Return from function; push result
+	LCall,								///< Call a leaf procedure, pushing a new LeafFrame
+	LRet,								///< Return from a leaf procedure; unlink LeafFrame
 	Jump,								///< Jump to a location
 	JNEQ,								///< Condition = pop(); Jump if condition == false (0)
+	JTab,								///< Index = pop(); Jump via the index'th of the addr jumps that follow, else the last
+	ForTest,							///< Limit, step, variable address; pop them, and jump if done
+	ForNext,							///< Limit, step, variable address; step, and jump, unless that passes the limit
 
 	Halt = 255							///< Halt the machine
 };
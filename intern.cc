@@ -0,0 +1,122 @@
+/**	@file	intern.cc
+ *
+ * The PL/0C identifier interner implementation
+ *
+ * @author Randy Merkel, Slowly but Surly Software.
+ * @copyright  (c) 2017 Slowly but Surly Software. All rights reserved.
+ */
+
+#include "intern.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using namespace std;
+
+// private static
+
+const Interner::Id Interner::none = ~static_cast<Interner::Id>(0);
+
+// public
+
+Interner::Interner() : used{blockSize}, table(256, none) {}
+
+/**
+ * @param	s	The identifier's spelling
+ * @param	n	The spelling's length
+ * @return	The identifier's id, which is assigned if s hasn't been seen before
+ */
+Interner::Id Interner::intern(const char* s, size_t n) {
+	const auto h = hash(s, n);
+	auto mask = table.size() - 1;
+
+	auto i = h & mask;
+	for (; table[i] != none; i = (i + 1) & mask) {
+		const Name& name = names[table[i]];
+		if (name.hash == h && name.length == n && memcmp(name.chars, s, n) == 0)
+			return table[i];
+	}
+
+	if (2 * (names.size() + 1) > table.size()) {	// Keep the load factor under 1/2
+		grow();
+		mask = table.size() - 1;
+		for (i = h & mask; table[i] != none; i = (i + 1) & mask)
+			;
+	}
+
+	char* chars = alloc(n + 1);
+	memcpy(chars, s, n);
+	chars[n] = '\0';
+
+	const Id id = names.size();
+	names.push_back({ chars, static_cast<uint32_t>(n), h });
+	table[i] = id;
+	return id;
+}
+
+/**
+ * @param	id	An interned identifier
+ * @return	The identifier's spelling
+ */
+const char* Interner::name(Id id) const {
+	assert(id < names.size());
+	return names[id].chars;
+}
+
+/**
+ * @param	id	An interned identifier
+ * @return	The length of the identifier's spelling
+ */
+size_t Interner::length(Id id) const {
+	assert(id < names.size());
+	return names[id].length;
+}
+
+// private static
+
+/**
+ * FNV-1a
+ * @param	s	The spelling to hash
+ * @param	n	The spelling's length
+ * @return	s's hash
+ */
+uint32_t Interner::hash(const char* s, size_t n) {
+	uint32_t h = 2166136261u;
+	while (n-- > 0) {
+		h ^= static_cast<unsigned char>(*s++);
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+// private
+
+/**
+ * Names longer than a block are given a block of their own.
+ * @param	n	Number of characters required
+ * @return	n characters from the arena
+ */
+char* Interner::alloc(size_t n) {
+	if (used + n > blockSize) {
+		blocks.emplace_back(new char[max(n, static_cast<size_t>(blockSize))]);
+		used = 0;
+	}
+
+	char* p = blocks.back().get() + used;
+	used += n;
+	return p;
+}
+
+void Interner::grow() {
+	table.assign(table.size() * 2, none);
+
+	const auto mask = table.size() - 1;
+	for (Id id = 0; id < names.size(); ++id) {
+		auto i = names[id].hash & mask;
+		while (table[i] != none)
+			i = (i + 1) & mask;
+		table[i] = id;
+	}
+}
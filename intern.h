@@ -0,0 +1,61 @@
+/**	@file	intern.h
+ *
+ * The PL/0C identifier interner
+ *
+ * @author Randy Merkel, Slowly but Surly Software.
+ * @copyright  (c) 2017 Slowly but Surly Software. All rights reserved.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** An identifier interner
+ *
+ * Each distinct identifier is copied, once, into an arena of blockSize character blocks, and
+ * assigned the next 32-bit id. Equal identifiers have equal ids, so they may be compared, and
+ * hashed, as integers; the spelling is only needed for diagnostics. Names are never moved, or
+ * freed, until the interner is destroyed.
+ */
+class Interner {
+public:
+	typedef std::uint32_t Id;					///< An interned identifier
+
+	static const std::size_t blockSize = 4096;	///< Arena block size, in characters
+
+	Interner();									///< Constructor
+
+	Id intern(const char* s, std::size_t n);	///< Intern the n characters at s
+
+	/// Intern s
+	Id intern(const std::string& s)				{	return intern(s.data(), s.size());	}
+
+	const char* name(Id id) const;				///< id's spelling, nul terminated
+	std::size_t length(Id id) const;			///< Length of id's spelling
+	std::size_t size() const					{	return names.size();	}	///< # of ids
+
+private:
+	static const Id none;						///< An empty table slot
+
+	/// An interned name
+	struct Name {
+		const char*		chars;					///< The spelling, nul terminated
+		std::uint32_t	length;					///< The spelling's length
+		std::uint32_t	hash;					///< The spelling's hash
+	};
+
+	std::vector<std::unique_ptr<char[]>> blocks;	///< The arena
+	std::size_t			used;					///< Characters used in the last block
+	std::vector<Name>	names;					///< Names, indexed by id
+	std::vector<Id>		table;					///< Open addressing hash table of ids
+
+	static std::uint32_t hash(const char* s, std::size_t n);
+	char* alloc(std::size_t n);					///< Allocate n characters from the arena
+	void grow();								///< Double the size of the table
+};
+
+#endif
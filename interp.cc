@@ -21,6 +21,8 @@ using namespace std;
 
 /// Dump the current machine state
 void Interp::dump() {
+	if (quiet) return;
+
 	cout << fixed;							// Use fixed format for floating point values;
 
 	// Dump the last write
@@ -88,6 +90,31 @@ void Interp::push(Datum d) {
 	stack[++sp] = d;
 }
 
+/**
+ * The loop's limit, step and variable address are on top of the stack, in that order.
+ * @return true if the loop variable hasn't passed the limit, in the direction of the step.
+ */
+bool Interp::forMore() const {
+	const auto value = stack[stack[sp].uinteger()].integer();
+	const auto step = stack[sp - 1].integer();
+	const auto limit = stack[sp - 2].integer();
+
+	return step < 0 ? value >= limit : value <= limit;
+}
+
+/**
+ * The loop's limit, step and variable address are on top of the stack, in that order. The
+ * distance to the limit is computed in 64 bits, so that neither it, nor the step, can overflow.
+ * @return true if the loop variable can take another step without passing the limit.
+ */
+bool Interp::forStep() const {
+	const long long value = stack[stack[sp].uinteger()].integer();
+	const long long step = stack[sp - 1].integer();
+	const long long limit = stack[sp - 2].integer();
+
+	return step < 0 ? value - limit >= -step : limit - value >= step;
+}
+
 /**
  * @param 	nlevel	Set the subroutines frame base nlevel's down
  * @param 	addr 	The address of the subroutine.
@@ -128,6 +155,33 @@ void Interp::retf() {
 	push(temp);
 }
 
+/**
+ * Leaf procedures don't reference other frames, or return a value, so the frame is just the
+ * saved frame pointer and return address.
+ * @param 	addr 	The address of the leaf procedure.
+ */
+void Interp::lcall(Datum::Unsigned addr) {
+	mkStackSpace(LeafFrameSize);
+
+	const auto oldFp = fp;			// Save a copy before we modify it
+
+	fp = sp + 1;					// fp points to the start of the new frame
+	push(oldFp);					//	LeafFrameOldFp
+	push(pc);						//	LeafFrameRetAddr
+
+	pc = addr;
+}
+
+/**
+ * Unlinks the leaf stack frame, setting the return address as the next instruciton.
+ */
+void Interp::lret() {
+	sp = fp - 1; 					// "pop" the activaction frame
+	pc = stack[fp + LeafFrameRetAddr].uinteger();
+	fp = stack[fp + LeafFrameOldFp].uinteger();
+	sp -= ir.addr.uinteger();		// Pop parameters, if any...
+}
+
 /// @return Result::success or...
 Interp::Result Interp::step() {
 	auto prevPc = pc;					// The previous pc
@@ -136,7 +190,8 @@ Interp::Result Interp::step() {
 
 	auto info = OpCodeInfo::info(ir.op);
 	if (sp < info.nElements()) {
-		cerr << "Out of bounds stack access @ pc (" << prevPc << "), sp == " << sp << "!\n";
+		if (!quiet)
+			cerr << "Out of bounds stack access @ pc (" << prevPc << "), sp == " << sp << "!\n";
 		return Result::stackUnderflow;
 	}
 
@@ -169,7 +224,8 @@ Interp::Result Interp::step() {
 			push(pop() / rhand);
 
 		else {
-			cerr << "Attempt to divide by zero @ pc (" << prevPc << ")!\n";
+			if (!quiet)
+				cerr << "Attempt to divide by zero @ pc (" << prevPc << ")!\n";
 			return Result::divideByZero;
 		}
 		break;
@@ -180,11 +236,15 @@ Interp::Result Interp::step() {
 			push(pop() % rhand);
 
 		else {
-			cerr << "attempt to divide by zero @ pc (" << prevPc << ")!\n";
+			if (!quiet)
+				cerr << "attempt to divide by zero @ pc (" << prevPc << ")!\n";
 			return Result::divideByZero;
 		}
 		break;
 
+	case OpCode::DivNZ:		rhand = pop(); push(pop() / rhand);		break;
+	case OpCode::RemNZ:		rhand = pop(); push(pop() % rhand);		break;
+
 	case OpCode::BOR:	 	rhand = pop(); push(pop()  | rhand);	break;
 	case OpCode::BAND:   	rhand = pop(); push(pop()  & rhand); 	break;
 	case OpCode::BXOR:   	rhand = pop(); push(pop()  ^ rhand); 	break;
@@ -198,7 +258,17 @@ Interp::Result Interp::step() {
 	case OpCode::NEQU:   	rhand = pop(); push(pop() != rhand); 	break;
 	case OpCode::LOR:   	rhand = pop(); push(pop() || rhand); 	break;
 	case OpCode::LAND:  	rhand = pop(); push(pop() && rhand); 	break;
+
+	case OpCode::Select:					// condition, then value, else value
+		rhand = pop();
+		if (stack[sp - 1].integer() == 0)
+			stack[sp] = rhand;
+		rhand = pop();
+		stack[sp] = rhand;
+		break;
+
 	case OpCode::Push: 		push(ir.addr);							break;
+	case OpCode::Dup:		push(stack[sp]);						break;
 
 	case OpCode::PushVar:
 		push(base(ir.level) + ir.addr.integer());
@@ -215,6 +285,8 @@ Interp::Result Interp::step() {
 	case OpCode::Call: 		call(ir.level, ir.addr.uinteger());		break;
 	case OpCode::Ret:   	ret();  								break;
 	case OpCode::Retf: 		retf();									break;
+	case OpCode::LCall:		lcall(ir.addr.uinteger());				break;
+	case OpCode::LRet:		lret();									break;
 
 	case OpCode::Enter:
 		mkStackSpace(ir.addr.uinteger());
@@ -228,10 +300,34 @@ Interp::Result Interp::step() {
 			pc = ir.addr.uinteger();
 		break;
 
+	case OpCode::ForTest:					// limit, step, variable address
+		if (!forMore()) {
+			sp -= 3;
+			pc = ir.addr.uinteger();
+		}
+		break;
+
+	case OpCode::ForNext:					// limit, step, variable address
+		if (forStep()) {
+			lastWrite = stack[sp].uinteger();
+			stack[lastWrite] = stack[lastWrite].integer() + stack[sp - 1].integer();
+			pc = ir.addr.uinteger();
+		} else
+			sp -= 3;
+		break;
+
+	case OpCode::JTab: {					// The index'th jump, or the last if out of range
+		const auto index = pop().integer();
+		const auto n = ir.addr.integer();
+		pc += index >= 0 && index < n ? index : n;
+		break;
+	}
+
 	case OpCode::Halt:		return Result::halted;					break;
 
 	default:
-		cerr 	<< "Unknown op code: " << OpCodeInfo::info(ir.op).name()
+		if (!quiet)
+			cerr 	<< "Unknown op code: " << OpCodeInfo::info(ir.op).name()
 				<< " found at pc (" << prevPc << ")!\n" << endl;
 		return Result::unknownInstr;
 	};
@@ -250,14 +346,19 @@ Interp::Result Interp::run() {
 	Result status = Result::success;
 	do {
 		if (pc >= code.size()) {
-			cerr << "pc (" << pc << ") is out of range: [0.." << code.size() << ")!\n";
+			if (!quiet)
+				cerr << "pc (" << pc << ") is out of range: [0.." << code.size() << ")!\n";
 			status = Result::badFetch;
 
 		} else if (sp >= stack.size()) {
-			cerr << "sp (" << sp << ") is out of range [0.." << stack.size() << ")!\n";
+			if (!quiet)
+				cerr << "sp (" << sp << ") is out of range [0.." << stack.size() << ")!\n";
 			status = Result::stackUnderflow;
 
-		} else {
+		} else if (limit && ncycles >= limit)
+			status = Result::cycleLimit;
+
+		else {
 			dump();							// Dump state and disasm the next instruction
 			status = step();
 		}
@@ -272,7 +373,7 @@ Interp::Result Interp::run() {
 /**
  *  Initialize the machine into a reset state with verbose == false.
  */
-Interp::Interp() : stack(FrameSize), verbose(false), ncycles(0)	{
+Interp::Interp() : stack(FrameSize), verbose(false), quiet(false), ncycles(0), limit(0)	{
 	reset();
 }
 
@@ -294,12 +395,52 @@ Interp::Result Interp::operator()(const InstrVector& program, bool ver) {
 	return result;
 }
 
+/**
+ * The call is appended to program, followed by a halt, and run from the initial activation
+ * frame, without writing anything to standard output, or standard error.
+ *
+ *	@param		program	The program
+ *	@param		entry	The functions entry point
+ *	@param		args	The actual parameters
+ *	@param		budget	The maximum number of machine cycles to run
+ *	@param[out]	result	The function result, if successful
+ *  @return	Result::success, Result::cycleLimit, or ...
+ */
+Interp::Result Interp::evaluate(	const InstrVector&	program,
+									Datum::Unsigned		entry,
+									const DatumVector&	args,
+									size_t				budget,
+									Datum&				result) {
+	verbose = false;
+	quiet = true;
+	limit = budget;
+
+	code = program;
+	const Datum::Unsigned start = code.size();
+	for (const auto& arg : args)
+		code.push_back(Instr(OpCode::Push, 0, arg));
+	code.push_back(Instr(OpCode::Call, 0, entry));
+	code.push_back(Instr(OpCode::Halt));
+
+	reset();
+	pc = start;
+
+	auto status = run();
+	if (Result::halted == status) {
+		status = sp == FrameSize ? Result::success : Result::stackUnderflow;
+		result = stack[sp];
+	}
+
+	quiet = false;
+	limit = 0;
+	return status;
+}
+
 void Interp::reset() {
 	pc = 0;
 
 	fp = 0;									// Setup the initial activacation frame
-	for (sp = 0; sp < FrameSize; ++sp)
-		stack[sp] = 0;
+	stack.assign(FrameSize, 0);
 	sp = stack.size() - 1;
 
 	ncycles = 0;
@@ -324,6 +465,7 @@ string Interp::toString(Result r) {
 	case Result::unknownInstr:		return "unknownInstr";		break;
 	case Result::stackOverflow:		return "stackOverflow";		break;
 	case Result::stackUnderflow:	return "stackUnderflow";	break;
+	case Result::cycleLimit:		return "cycleLimit";		break;
 	case Result::halted:			return "halted";			break;
 	default:						return "undefined error!";
 	}
@@ -31,6 +31,7 @@ public:
 		unknownInstr,						///< Attempt to execute an undefined instruction
 		stackOverflow,						///< Attempt to access beyound the end of the statck
 		stackUnderflow,						///< Attempt to access an empty stack
+		cycleLimit,							///< Ran out of machine cycles
 		halted								///< Machine has halted
 	};
 
@@ -41,6 +42,14 @@ public:
 
 	/// Load a applicaton and start the pl/0 machine running...
 	Result operator()(const InstrVector& program, bool v = false);
+
+	/// Quietly evaluate a call to a function, with constant parameters, in limited cycles...
+	Result evaluate(	const InstrVector&	program,
+						Datum::Unsigned		entry,
+						const DatumVector&	args,
+						std::size_t			budget,
+						Datum&				result);
+
 	void reset();							///< Reset the machine back to it's initial state.
 	size_t cycles() const;					///< Return number of machine cycles run so far
 
@@ -75,7 +84,9 @@ private:
 
 	EAddr			lastWrite;				///< Last write effective address (to stack[]), if valid
 	bool			verbose;				///< Verbose output if true
+	bool			quiet;					///< No output at all, if true
 	unsigned  		ncycles;				///< Number of machine cycles run since the last reset
+	std::size_t		limit;					///< Maximum number of cycles to run, or 0 for no limit
 
 	void dump();
 
@@ -88,11 +99,20 @@ protected:
 	Datum pop();							///< Pop a Datum from the top of stack...
 	void push(Datum d);						///< Push a Datum onto the stack...
 
+	/// Does the for loop on top of the stack have more iterations?
+	bool forMore() const;
+
+	/// Can the for loop on top of the stack step its variable?
+	bool forStep() const;
+
 	/// Call a subroutine...
 	void call(int8_t nlevel, Datum::Unsigned addr);
 	void ret();								///< Return from procedure...
 	void retf();							///< Return from a function...
 
+	void lcall(Datum::Unsigned addr);		///< Call a leaf procedure...
+	void lret();							///< Return from a leaf procedure...
+
 	Result step();							///< Single step the machine...
 	Result run();							///< Run the machine...
 };
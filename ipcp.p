@@ -0,0 +1,26 @@
+{ Parameters passed the same constant by every call are replaced	}
+{ by that constant, and calls passing other constants call a		}
+{ specialized copy of the subroutine, at -O2						}
+var total : integer;
+
+function scale(x, factor : integer) : integer
+	begin
+		scale = x * factor
+	end;
+
+procedure add(n, times : integer)
+	var i : integer;
+	begin
+		i = 0;
+		while i < times do begin
+			total = total + scale(n, 2);
+			i = i + 1
+		end
+	end;
+
+begin
+	total = 0;
+	add(3, 4);
+	add(5, 4);
+	add(total, 4)
+end.
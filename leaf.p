@@ -0,0 +1,24 @@
+{ Leaf procedures, i.e., those that make no calls, and only	}
+{ reference their own frame, use a minimal frame at -O1		}
+var x, y : integer;
+
+procedure swap(a, b : integer)
+	var t : integer;
+	begin
+		t = a;
+		a = b;
+		b = t
+	end;
+
+procedure bump()
+	begin
+		x = x + 1;
+		swap(x, y)
+	end;
+
+begin
+	x = 1;
+	y = 2;
+	swap(x, y);
+	bump()
+end.
@@ -0,0 +1,40 @@
+{ Nested subroutines that only read variables from enclosing	}
+{ blocks are passed them as parameters at -O2					}
+var scale, total, left : integer;
+
+procedure accumulate(n : integer)
+	var i : integer;
+
+	function scaled(x : integer) : integer
+		begin
+			scaled = x * scale + n
+		end;
+
+	begin
+		i = 0;
+		while i < n do begin
+			total = total + scaled(i);
+			i = i + 1
+		end
+	end;
+
+procedure drain()
+	function more() : integer
+		begin
+			more = left
+		end;
+
+	begin
+		while more() > 0 do begin		{ loops back to the call	}
+			total = total + left;
+			left = left - 1
+		end
+	end;
+
+begin
+	scale = 3;
+	total = 0;
+	accumulate(4);						{ s/b 34					}
+	left = 4;
+	drain()								{ s/b 44					}
+end.
@@ -0,0 +1,2074 @@
+/** @file opt.cc
+ *
+ * PL/0C bytecode optimization passes implementation
+ *
+ * @author Randy Merkel, Slowly but Surly Software.
+ * @copyright  (c) 2017 Slowly but Surly Software. All rights reserved.
+ */
+
+#include "opt.h"
+#include "interp.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <set>
+#include <utility>
+
+using namespace std;
+
+/**
+ * Fold a unary operation on a constant.
+ * @param		op		The operation
+ * @param		d		The operand
+ * @param[out]	result	The result, if folded
+ * @return	true if op was folded
+ */
+static bool fold(OpCode op, Datum d, Datum& result) {
+	switch (op) {
+	case OpCode::Not:	result = !d;	return true;
+	case OpCode::Neg:	result = -d;	return true;
+	case OpCode::Comp:
+		if (Datum::Kind::Real == d.kind()) return false;
+		result = ~d;
+		return true;
+
+	case OpCode::ITOR:
+		if (Datum::Kind::Integer != d.kind()) return false;
+		result = d.integer() * 1.0;
+		return true;
+
+	case OpCode::RTOI:
+		if (Datum::Kind::Real != d.kind()) return false;
+		result = static_cast<Datum::Integer>(round(d.real()));
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * Fold a binary operation on two constants, of the same kind, just as Interp would evaluate it.
+ * @param		op		The operation
+ * @param		l		The left-hand operand
+ * @param		r		The right-hand operand
+ * @param[out]	result	The result, if folded
+ * @return	true if op was folded
+ */
+static bool fold(OpCode op, Datum l, Datum r, Datum& result) {
+	if (l.kind() != r.kind())
+		return false;
+
+	const bool real = Datum::Kind::Real == l.kind();
+	const bool zero = real ? r.real() == 0 : r.integer() == 0;
+
+	switch (op) {
+	case OpCode::Add:		result = l + r;		return true;
+	case OpCode::Sub:		result = l - r;		return true;
+	case OpCode::Mul:		result = l * r;		return true;
+
+	case OpCode::Div:								// leave divide by zero to the machine
+		if (zero) return false;
+		result = l / r;
+		return true;
+
+	case OpCode::Rem:
+		if (zero || real) return false;
+		result = l % r;
+		return true;
+
+	case OpCode::BOR:
+		if (real) return false;
+		result = l | r;
+		return true;
+
+	case OpCode::BXOR:
+		if (real) return false;
+		result = l ^ r;
+		return true;
+
+	case OpCode::LT:		result = l <  r;	return true;
+	case OpCode::LTE:		result = l <= r;	return true;
+	case OpCode::EQU:		result = l == r;	return true;
+	case OpCode::GTE:		result = l >= r;	return true;
+	case OpCode::GT:		result = l >  r;	return true;
+	case OpCode::NEQU:		result = l != r;	return true;
+	case OpCode::LOR:		result = l || r;	return true;
+	case OpCode::LAND:		result = l && r;	return true;
+
+	default:
+		return false;
+	}
+}
+
+/// @return true if op is a jump, conditional or not, i.e., a branch other than a call
+static bool jump(OpCode op) {
+	switch (op) {
+	case OpCode::Jump:
+	case OpCode::JNEQ:
+	case OpCode::ForTest:
+	case OpCode::ForNext:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/// A variable reference; a level and offset
+typedef pair<int, Datum::Integer>	Var;
+
+/// A loop; the layout range head..back, where back branches back to head
+struct Loop {
+	Editor::Node	head;						///< The loop entry
+	Editor::Node	back;						///< The branch back to head
+};
+
+/**
+ * Find a for loop's variable, which ForNext writes via the address pushed ahead of the loop's
+ * ForTest; pushvar v, fortest, head: ..., fornext head.
+ * @param		ed	The program
+ * @param		n	The ForNext
+ * @param[out]	var	The loop variable
+ * @return	false if the variable couldn't be found
+ */
+static bool forVar(Editor& ed, Editor::Node n, Var& var) {
+	const auto test = ed.prev(ed.target(n));
+	if (Editor::none == test || OpCode::ForTest != ed[test].op)
+		return false;
+
+	const auto ref = ed.prev(test);
+	if (Editor::none == ref || OpCode::PushVar != ed[ref].op)
+		return false;
+
+	var = { ed[ref].level, ed[ref].addr.integer() };
+	return true;
+}
+
+/**
+ * @param	ed	The program
+ * @param	s	The subroutine
+ * @return	The nodes of subroutine s's body, in order.
+ */
+static vector<Editor::Node> body(const Editor& ed, size_t s) {
+	vector<Editor::Node> nodes;
+
+	for (auto n = ed.entry(s); ; n = ed.next(n)) {
+		nodes.push_back(n);
+		if (n == ed.exit(s)) break;
+	}
+
+	return nodes;
+}
+
+/**
+ * @param	nodes	A subroutine body
+ * @return	The position of each node in nodes
+ */
+static map<Editor::Node, size_t> positions(const vector<Editor::Node>& nodes) {
+	map<Editor::Node, size_t> pos;
+	for (size_t i = 0; i < nodes.size(); ++i)
+		pos[nodes[i]] = i;
+	return pos;
+}
+
+/**
+ * Find the loops in a subroutine body; each branch back to an earlier instruction closes a loop.
+ * @param	ed		The program
+ * @param	nodes	A subroutine body
+ * @return	The loops, outermost first
+ */
+static vector<Loop> loops(Editor& ed, const vector<Editor::Node>& nodes) {
+	auto pos = positions(nodes);
+	vector<Loop> result;
+
+	for (auto n : nodes) {
+		const auto op = ed[n].op;
+		if (jump(op) && pos.count(ed.target(n)) && pos[ed.target(n)] <= pos[n])
+			result.push_back({ ed.target(n), n });
+	}
+
+	stable_sort(result.begin(), result.end(), [&pos](const Loop& a, const Loop& b) {
+		return pos[a.back] - pos[a.head] > pos[b.back] - pos[b.head];
+	});
+
+	return result;
+}
+
+/**
+ * Allocate a new local variable in a subroutine's frame, inserting an Enter if the subroutine
+ * doesn't have one.
+ * @param	ed	The program
+ * @param	s	The subroutine
+ * @return	The new variables frame offset
+ */
+static Datum::Integer allocLocal(Editor& ed, size_t s) {
+	const auto e = ed.entry(s);
+
+	if (OpCode::Enter == ed[e].op) {
+		const auto n = ed[e].addr.integer();
+		ed[e].addr = n + 1;
+		return FrameSize + n;
+	}
+
+	ed.entry(s, ed.insert(e, Instr(OpCode::Enter, 0, 1)));
+	return FrameSize;
+}
+
+/**
+ * @param	ed		The program
+ * @param	prog	The program's subroutines
+ * @return	The subroutine index of each subroutine entry node
+ */
+static map<Editor::Node, size_t> callees(const Editor& ed, const Program& prog) {
+	map<Editor::Node, size_t> result;
+	for (size_t s = 0; s < prog.subrs.size(); ++s)
+		result[ed.entry(s)] = s;
+	return result;
+}
+
+/**
+ * The number of stack elements an instruction pops, and then pushes.
+ * @param		ed		The program
+ * @param		prog	The program's subroutines
+ * @param		subrs	Subroutine entry nodes to subroutine indexes
+ * @param		n		The instruction
+ * @param[out]	pops	Number of elements popped
+ * @param[out]	pushes	Number of elements pushed
+ * @return	false if n transfers control other than by calling a known subroutine
+ */
+static bool effect(	Editor&								ed,
+					const Program&						prog,
+					const map<Editor::Node, size_t>&	subrs,
+					Editor::Node						n,
+					unsigned&							pops,
+					unsigned&							pushes) {
+	switch (ed[n].op) {
+	case OpCode::Not:	case OpCode::Neg:	case OpCode::Comp:
+	case OpCode::ITOR:	case OpCode::RTOI:	case OpCode::Eval:
+		pops = 1; pushes = 1;
+		return true;
+
+	case OpCode::ITOR2:
+		pops = 2; pushes = 2;
+		return true;
+
+	case OpCode::Add:	case OpCode::Sub:	case OpCode::Mul:	case OpCode::Div:	case OpCode::Rem:
+	case OpCode::DivNZ:	case OpCode::RemNZ:
+	case OpCode::BOR:	case OpCode::BAND:	case OpCode::BXOR:	case OpCode::LShift: case OpCode::RShift:
+	case OpCode::LT:	case OpCode::LTE:	case OpCode::EQU:	case OpCode::GTE:	case OpCode::GT:
+	case OpCode::NEQU:	case OpCode::LOR:	case OpCode::LAND:
+		pops = 2; pushes = 1;
+		return true;
+
+	case OpCode::Select:
+		pops = 3; pushes = 1;
+		return true;
+
+	case OpCode::Dup:
+		pops = 1; pushes = 2;
+		return true;
+
+	case OpCode::Push:	case OpCode::PushVar:
+		pops = 0; pushes = 1;
+		return true;
+
+	case OpCode::Assign:
+		pops = 2; pushes = 0;
+		return true;
+
+	case OpCode::Call:	case OpCode::LCall: {
+		const auto i = subrs.find(ed.target(n));
+		if (i == subrs.end()) return false;
+		pops = prog.subrs[i->second].nParams;
+		pushes = prog.subrs[i->second].function ? 1 : 0;
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * Find where each of a call's actual parameters is evaluated, by walking back from the call
+ * within its basic block.
+ * @param		ed		The program
+ * @param		prog	The program's subroutines
+ * @param		subrs	Subroutine entry nodes to subroutine indexes
+ * @param		call	The call
+ * @param		nParams	The number of actual parameters
+ * @param[out]	starts	The first instruction of each actual parameter
+ * @return	false if the actual parameters couldn't be found
+ */
+static bool actuals(Editor&								ed,
+					const Program&						prog,
+					const map<Editor::Node, size_t>&	subrs,
+					Editor::Node						call,
+					unsigned							nParams,
+					vector<Editor::Node>&				starts) {
+	starts.assign(nParams, Editor::none);
+
+	auto n = call;
+	for (auto i = nParams; i > 0; --i) {
+		int want = 1;							// Values needed to complete the parameter
+		do {
+			if (ed.targeted(n) || Editor::none == ed.prev(n))
+				return false;					// Don't cross into another block
+			n = ed.prev(n);
+
+			unsigned pops, pushes;
+			if (!effect(ed, prog, subrs, n, pops, pushes))
+				return false;
+			if (OpCode::ITOR2 == ed[n].op && want < 2)
+				return false;					// Converts the previous parameter
+			want += static_cast<int>(pops) - static_cast<int>(pushes);
+			if (want < 0)
+				return false;
+
+		} while (want > 0);
+
+		starts[i - 1] = n;
+	}
+
+	return true;
+}
+
+/// @return true if a and b are the same kind, and value
+static bool same(Datum a, Datum b) {
+	if (a.kind() != b.kind())
+		return false;
+	return Datum::Kind::Real == a.kind() ? a.real() == b.real() : a.integer() == b.integer();
+}
+
+/**
+ * @param	prog	The program's subroutines
+ * @param	s		A subroutine
+ * @return	The subroutines nested within s, and the number of levels each is nested by
+ */
+static vector<pair<size_t, int>> descendants(const Program& prog, size_t s) {
+	vector<pair<size_t, int>> result;
+
+	for (size_t q = 0; q < prog.subrs.size(); ++q)
+		for (auto p = prog.subrs[q].parent; p >= 0; p = prog.subrs[p].parent)
+			if (static_cast<size_t>(p) == s) {
+				result.push_back({ q, prog.subrs[q].level - prog.subrs[s].level });
+				break;
+			}
+
+	return result;
+}
+
+/**
+ * Copy instructions ahead of a node; branches to instructions within the copy refer to the copy.
+ * @param	ed		The program
+ * @param	nodes	The instructions to copy, in order
+ * @param	at		Insert the copy ahead of this node
+ * @return	The copy of each node
+ */
+static map<Editor::Node, Editor::Node> copy(Editor& ed, const vector<Editor::Node>& nodes, Editor::Node at) {
+	map<Editor::Node, Editor::Node> copies;
+
+	for (auto n : nodes) {
+		const Instr instr = ed[n];
+		copies[n] = ed.insert(at, instr);
+	}
+
+	for (auto n : nodes)
+		if (isBranch(ed[n].op)) {
+			const auto t = ed.target(n);
+			ed.target(copies[n], copies.count(t) ? copies[t] : t);
+		}
+
+	return copies;
+}
+
+/**
+ * Copy a subroutine ahead of a node; branches within the body refer to the copy.
+ * @param	ed		The program
+ * @param	prog	The program's subroutines
+ * @param	s		The subroutine to copy
+ * @param	at		Insert the copy ahead of this node
+ * @return	The index of the copy
+ */
+static size_t clone(Editor& ed, Program& prog, size_t s, Editor::Node at) {
+	auto copies = copy(ed, body(ed, s), at);
+
+	auto subr = prog.subrs[s];
+	subr.name += "'";
+	return ed.subroutine(subr, copies[ed.entry(s)], copies[ed.exit(s)]);
+}
+
+/**
+ * Replace some of a subroutine's parameters with constants, removing them from its frame; the
+ * remaining parameters, and the return, are renumbered.
+ * @param	ed		The program
+ * @param	prog	The program's subroutines
+ * @param	s		The subroutine
+ * @param	values	The value of each parameter
+ * @param	replace	The parameters to replace
+ */
+static void specialize(	Editor&					ed,
+						Program&				prog,
+						size_t					s,
+						const vector<Datum>&	values,
+						const vector<bool>&		replace) {
+	const Datum::Integer nParams = prog.subrs[s].nParams;
+	const Datum::Unsigned remain = count(replace.begin(), replace.end(), false);
+
+	vector<Datum::Integer> offsets(nParams, 0);	// New offsets of the remaining parameters
+	Datum::Integer k = 0;
+	for (Datum::Integer j = 0; j < nParams; ++j)
+		if (!replace[j])
+			offsets[j] = k++ - remain;
+
+	for (auto n : body(ed, s)) {
+		auto& instr = ed[n];
+		if (ed.erased(n))
+			continue;
+
+		else if (OpCode::PushVar == instr.op && 0 == instr.level && instr.addr.integer() < 0) {
+			const auto j = instr.addr.integer() + nParams;
+			if (replace[j]) {
+				instr = Instr(OpCode::Push, 0, values[j]);
+				ed.erase(ed.next(n));
+			} else
+				instr.addr = offsets[j];
+
+		} else if (OpCode::Ret == instr.op || OpCode::Retf == instr.op)
+			instr.addr = remain;
+	}
+
+	for (const auto& d : descendants(prog, s))
+		for (auto n : body(ed, d.first)) {
+			auto& instr = ed[n];
+			if (OpCode::PushVar == instr.op && d.second == instr.level && instr.addr.integer() < 0)
+				instr.addr = offsets[instr.addr.integer() + nParams];
+		}
+
+	prog.subrs[s].nParams = remain;
+}
+
+/************************************************************************************************
+ *	class ConstProp
+ ************************************************************************************************/
+
+/// A call site, and the Push of each constant actual parameter, or none
+struct CallSite {
+	Editor::Node			call;				///< The call
+	vector<Editor::Node>	consts;				///< Constant actual parameters
+};
+
+/// Call sites that pass the same constants
+typedef vector<CallSite>	CallGroup;
+
+/**
+ * @param	ed	The program
+ * @param	a	A call site
+ * @param	b	Another call site
+ * @return	true if a and b pass the same constants, in the same parameters
+ */
+static bool sameConsts(Editor& ed, const CallSite& a, const CallSite& b) {
+	for (size_t j = 0; j < a.consts.size(); ++j) {
+		const auto x = a.consts[j], y = b.consts[j];
+		if ((Editor::none == x) != (Editor::none == y))
+			return false;
+		if (Editor::none != x && !same(ed[x].addr, ed[y].addr))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Retarget a group of call sites to subroutine s, removing the constant actual parameters that s
+ * no longer takes.
+ * @param	ed		The program
+ * @param	s		The subroutine
+ * @param	group	The call sites
+ * @param	replace	The parameters that s no longer takes
+ */
+static void retarget(Editor& ed, size_t s, const CallGroup& group, const vector<bool>& replace) {
+	for (const auto& site : group) {
+		ed.target(site.call, ed.entry(s));
+		for (size_t j = 0; j < replace.size(); ++j)
+			if (replace[j])
+				ed.erase(site.consts[j]);
+	}
+}
+
+/**
+ * @param	prog	The program to optimize
+ */
+void ConstProp::operator()(Program& prog) {
+	Editor ed(prog);
+
+	// Subroutines are declared ahead of their callers, so visiting the latest first lets the
+	// constants in a caller's clones propagate into its callees. Clones aren't revisited.
+
+	for (size_t s = prog.subrs.size() - 1; s > 0; --s) {
+		const Datum::Integer nParams = prog.subrs[s].nParams;
+		if (0 == nParams)
+			continue;
+
+		// Only parameters that s just reads, and nested subroutines don't reference, may be
+		// replaced...
+
+		vector<bool> readOnly(nParams, true);
+		bool recursive = false;
+		for (auto n : body(ed, s)) {
+			const auto& instr = ed[n];
+			if (OpCode::PushVar == instr.op && 0 == instr.level && instr.addr.integer() < 0) {
+				if (OpCode::Eval != ed[ed.next(n)].op)
+					readOnly[instr.addr.integer() + nParams] = false;
+
+			} else if (OpCode::Call == instr.op && ed.target(n) == ed.entry(s))
+				recursive = true;
+		}
+
+		const auto nested = descendants(prog, s);
+		for (const auto& d : nested)
+			for (auto n : body(ed, d.first)) {
+				const auto& instr = ed[n];
+				if (OpCode::PushVar == instr.op && d.second == instr.level && instr.addr.integer() < 0)
+					readOnly[instr.addr.integer() + nParams] = false;
+			}
+
+		if (find(readOnly.begin(), readOnly.end(), true) == readOnly.end())
+			continue;
+
+		// Group the call sites by the constants they pass...
+
+		const auto subrs = callees(ed, prog);
+		vector<CallGroup> groups;
+		for (auto n = ed.begin(); n != Editor::none; n = ed.next(n)) {
+			if (OpCode::Call != ed[n].op || ed.target(n) != ed.entry(s))
+				continue;
+
+			CallSite site { n, vector<Editor::Node>(nParams, Editor::none) };
+			vector<Editor::Node> starts;
+			if (actuals(ed, prog, subrs, n, nParams, starts))
+				for (Datum::Integer j = 0; j < nParams; ++j) {
+					const auto end = j + 1 < nParams ? starts[j + 1] : n;
+					if (readOnly[j] && OpCode::Push == ed[starts[j]].op && ed.next(starts[j]) == end)
+						site.consts[j] = starts[j];
+				}
+
+			auto g = find_if(groups.begin(), groups.end(), [&](const CallGroup& group) {
+				return sameConsts(ed, group.front(), site);
+			});
+			if (g == groups.end())
+				groups.push_back({ site });
+			else
+				g->push_back(site);
+		}
+
+		if (groups.empty())
+			continue;
+
+		stable_sort(groups.begin(), groups.end(), [](const CallGroup& a, const CallGroup& b) {
+			return a.size() > b.size();
+		});
+
+		// Parameters passed the same constant by every call site are replaced in s itself...
+
+		vector<bool> universal(nParams, true);
+		for (Datum::Integer j = 0; j < nParams; ++j)
+			for (const auto& g : groups) {
+				const auto c = g.front().consts[j], c0 = groups.front().front().consts[j];
+				universal[j] = universal[j] && Editor::none != c && same(ed[c].addr, ed[c0].addr);
+			}
+
+		vector<vector<bool>> known;				// Parameters each group passes constants for
+		vector<vector<Datum>> values;			// ... and their values
+		bool specific = true;					// Does every group pass other constants?
+		for (const auto& g : groups) {
+			vector<bool> k(nParams, false);
+			vector<Datum> v(nParams);
+			for (Datum::Integer j = 0; j < nParams; ++j)
+				if (Editor::none != g.front().consts[j]) {
+					k[j] = true;
+					v[j] = ed[g.front().consts[j]].addr;
+				}
+			specific = specific && k != universal;
+			known.push_back(k);
+			values.push_back(v);
+		}
+
+		// ...and if cloning is possible, other groups of call sites get their own copy. If
+		// every group has a copy of it's own, the largest keeps s.
+
+		const bool cloneable = !recursive && nested.empty();
+		const bool inPlace = cloneable && specific && groups.size() <= maxClones + 1;
+		const size_t first = inPlace ? 1 : 0;
+
+		for (size_t g = first; cloneable && g < groups.size() && g < first + maxClones; ++g) {
+			if (known[g] == universal)
+				continue;						// Nothing more specific to clone for
+
+			const auto c = clone(ed, prog, s, ed.entry(0));
+			specialize(ed, prog, c, values[g], known[g]);
+			retarget(ed, c, groups[g], known[g]);
+			groups[g].clear();
+		}
+
+		const auto& replace = inPlace ? known[0] : universal;
+		if (find(replace.begin(), replace.end(), true) == replace.end())
+			continue;
+
+		specialize(ed, prog, s, values[0], replace);
+		for (const auto& g : groups)
+			retarget(ed, s, g, replace);
+	}
+
+	ed.commit();
+}
+
+/************************************************************************************************
+ *	class ConstFold
+ ************************************************************************************************/
+
+/**
+ * Scans the code for push c, op, and push c1, push c2, op sequences, none of which are branch
+ * targets, replacing each with a single push of the result. After each fold the scan backs up
+ * an instruction, so that the result may fold with its predecessor.
+ *
+ * @param	prog	The program to optimize
+ */
+void ConstFold::operator()(Program& prog) {
+	Editor ed(prog);
+	Datum result;
+
+	for (auto n = ed.begin(); n != Editor::none; ) {
+		const auto op = ed[n].op;
+		const auto a = ed.prev(n);
+		const auto b = Editor::none == a ? Editor::none : ed.prev(a);
+
+		if (ed.targeted(n) || Editor::none == a || OpCode::Push != ed[a].op) {
+			n = ed.next(n);
+			continue;
+		}
+
+		if (fold(op, ed[a].addr, result)) {			// push c, op
+			ed[a].addr = result;
+			ed.erase(n);
+			n = a;
+
+		} else if (	OpCode::ITOR2 == op				// push c1, push c2, itor2
+				&&	!ed.targeted(a)
+				&&	Editor::none != b
+				&&	OpCode::Push == ed[b].op
+				&&	fold(OpCode::ITOR, ed[b].addr, result)) {
+			ed[b].addr = result;
+			ed.erase(n);
+			n = b;
+
+		} else if (	!ed.targeted(a) 					// push c1, push c2, op
+				&& 	Editor::none != b
+				&&	OpCode::Push == ed[b].op
+				&&	fold(op, ed[b].addr, ed[a].addr, result)) {
+			ed[b].addr = result;
+			ed.erase(a);
+			ed.erase(n);
+			n = b;
+
+		} else
+			n = ed.next(n);
+	}
+
+	ed.commit();
+}
+
+/************************************************************************************************
+ *	class PartialEval
+ ************************************************************************************************/
+
+/**
+ * Find the pure subroutines; those that only reference their own frame, and only call pure
+ * subroutines. Subroutines are assumed pure until shown otherwise, so that recursive
+ * subroutines may be pure.
+ * @param	ed		The program
+ * @param	prog	The program's subroutines
+ * @return	The pure subroutines
+ */
+static vector<bool> pure(Editor& ed, const Program& prog) {
+	const auto subrs = callees(ed, prog);
+	vector<bool> result(prog.subrs.size(), true);
+	result[0] = false;
+
+	for (bool changed = true; changed; ) {
+		changed = false;
+		for (size_t s = 1; s < prog.subrs.size(); ++s) {
+			if (!result[s])
+				continue;
+
+			for (auto n : body(ed, s)) {
+				const auto& instr = ed[n];
+				if (OpCode::PushVar == instr.op && 0 != instr.level)
+					result[s] = false;
+
+				else if (OpCode::Call == instr.op || OpCode::LCall == instr.op) {
+					const auto i = subrs.find(ed.target(n));
+					result[s] = result[s] && i != subrs.end() && result[i->second];
+				}
+			}
+
+			changed = changed || !result[s];
+		}
+	}
+
+	return result;
+}
+
+/**
+ * @param	prog	The program to optimize
+ */
+void PartialEval::operator()(Program& prog) {
+	Editor ed(prog);
+	const auto subrs = callees(ed, prog);
+	const auto isPure = pure(ed, prog);
+
+	/// A evaluated call
+	struct Evaluation {
+		size_t			subr;					///< The function
+		DatumVector		args;					///< The actual parameters
+		bool			success;				///< Was the call evaluated?
+		Datum			result;					///< The result, if so
+	};
+	vector<Evaluation> evaluations;
+	Interp machine;
+
+	for (auto n = ed.begin(); n != Editor::none; n = ed.next(n)) {
+		if (OpCode::Call != ed[n].op && OpCode::LCall != ed[n].op)
+			continue;
+
+		const auto i = subrs.find(ed.target(n));
+		if (i == subrs.end() || !isPure[i->second] || !prog.subrs[i->second].function)
+			continue;
+
+		// Are all of the actual parameters constants?
+
+		const auto s = i->second;
+		const auto nParams = prog.subrs[s].nParams;
+		vector<Editor::Node> starts;
+		if (!actuals(ed, prog, subrs, n, nParams, starts))
+			continue;
+
+		DatumVector args;
+		for (size_t j = 0; j < nParams; ++j) {
+			const auto end = j + 1 < nParams ? starts[j + 1] : n;
+			if (OpCode::Push == ed[starts[j]].op && ed.next(starts[j]) == end)
+				args.push_back(ed[starts[j]].addr);
+		}
+		if (args.size() != nParams)
+			continue;
+
+		// Evaluate the call, once for each set of parameters, in the code as it was...
+
+		auto e = find_if(evaluations.begin(), evaluations.end(), [&](const Evaluation& x) {
+			return x.subr == s && equal(args.begin(), args.end(), x.args.begin(), same);
+		});
+		if (e == evaluations.end()) {
+			Evaluation x { s, args, false, Datum() };
+			x.success = Interp::Result::success ==
+				machine.evaluate(prog.code, prog.subrs[s].entry, args, budget, x.result);
+			e = evaluations.insert(evaluations.end(), x);
+		}
+
+		if (!e->success)
+			continue;
+
+		for (auto start : starts)
+			ed.erase(start);
+		ed[n] = Instr(OpCode::Push, 0, e->result);
+		ed.target(n, Editor::none);
+	}
+
+	ed.commit();
+}
+
+/************************************************************************************************
+ *	class JumpThread
+ ************************************************************************************************/
+
+/**
+ * @param	prog	The program to optimize
+ */
+void JumpThread::operator()(Program& prog) {
+	Editor ed(prog);
+	Datum::Unsigned table = 0;						// Jump table entries yet to be seen
+
+	for (auto n = ed.begin(); n != Editor::none; ) {
+		auto next = ed.next(n);
+		const auto p = ed.prev(n);
+
+		if (OpCode::JTab == ed[n].op) {				// Its jumps are indexed; keep them all
+			table = ed[n].addr.uinteger() + 1;
+			n = next;
+			continue;
+		}
+
+		if (	OpCode::JNEQ == ed[n].op			// push c, jneq
+			&&	Editor::none != p && OpCode::Push == ed[p].op && !ed.targeted(n)
+			&&	Datum::Kind::Real != ed[p].addr.kind()) {
+			const bool taken = ed[p].addr.integer() == 0;	// just as Interp tests
+			ed.erase(p);
+			if (taken)
+				ed[n].op = OpCode::Jump;
+			else {
+				ed.erase(n);
+				n = next;
+				continue;
+			}
+		}
+
+		if (OpCode::Jump == ed[n].op || OpCode::JNEQ == ed[n].op) {
+			// Follow chains of jumps, giving up if we find a loop...
+			auto t = ed.target(n);
+			for (size_t hops = 0; OpCode::Jump == ed[t].op && ed.target(t) != t && hops < ed.size(); ++hops)
+				t = ed.target(t);
+			ed.target(n, t);
+
+			if (table > 0)
+				--table;
+			else if (OpCode::Jump == ed[n].op && t == next)
+				ed.erase(n);						// jump to the following instruction
+		}
+
+		n = next;
+	}
+
+	ed.commit();
+}
+
+/************************************************************************************************
+ *	class LambdaLift
+ ************************************************************************************************/
+
+/**
+ * @param	prog	The program to optimize
+ */
+void LambdaLift::operator()(Program& prog) {
+	Editor ed(prog);
+
+	for (size_t s = 1; s < prog.subrs.size(); ++s) {
+		vector<Var>	free;						// The free variables, in order of reference
+		bool		liftable = true;
+
+		for (auto n = ed.entry(s); liftable; n = ed.next(n)) {
+			const auto& instr = ed[n];
+			if (OpCode::Call == instr.op || OpCode::LCall == instr.op)
+				liftable = false;				// a callee might write a free variable
+
+			else if (OpCode::PushVar == instr.op && instr.level > 0) {
+				const Var var { instr.level, instr.addr.integer() };
+				if (OpCode::Eval != ed[ed.next(n)].op)
+					liftable = false;			// Writes, or takes the address of, var
+
+				else if (find(free.begin(), free.end(), var) == free.end())
+					free.push_back(var);
+			}
+
+			if (n == ed.exit(s)) break;
+		}
+
+		if (!liftable || free.empty() || free.size() > maxFree)
+			continue;
+
+		const Datum::Integer k = free.size();	// Parameter offsets move down by k...
+		for (auto n = ed.entry(s); ; n = ed.next(n)) {
+			auto& instr = ed[n];
+			if (OpCode::PushVar == instr.op && instr.level > 0) {
+				const Var var { instr.level, instr.addr.integer() };
+				const Datum::Integer j = find(free.begin(), free.end(), var) - free.begin();
+				instr.level = 0;
+				instr.addr = j - k;
+
+			} else if (OpCode::PushVar == instr.op && instr.addr.integer() < 0)
+				instr.addr = instr.addr.integer() - k;
+
+			else if (OpCode::Ret == instr.op || OpCode::Retf == instr.op)
+				instr.addr = instr.addr.uinteger() + k;
+
+			if (n == ed.exit(s)) break;
+		}
+		prog.subrs[s].nParams += k;
+
+		// Each call site pushes the free variables; the callers static chain reaches the same
+		// frames, level + callee level - 1 levels down. Branches to the call, e.g., back to a
+		// loop condition, now branch to the pushes.
+
+		for (auto n = ed.begin(); n != Editor::none; n = ed.next(n))
+			if (OpCode::Call == ed[n].op && ed.target(n) == ed.entry(s)) {
+				Editor::Node first = Editor::none;
+				for (const auto& var : free) {
+					const auto m = ed.insert(n, Instr(OpCode::PushVar, ed[n].level + var.first - 1, var.second));
+					ed.insert(n, Instr(OpCode::Eval));
+					if (Editor::none == first) first = m;
+				}
+				ed.redirect(n, first);
+			}
+	}
+
+	ed.commit();
+}
+
+/************************************************************************************************
+ *	class ScalarPromote
+ ************************************************************************************************/
+
+/**
+ * Checks that loop is only entered via its head, makes no calls, and references its outer
+ * variables only to read or write them. The variable of a for loop ending within the loop is
+ * written via its address, which is taken ahead of the loop, so it's left in place.
+ * @param		ed		The program
+ * @param		nodes	The subroutine body
+ * @param		loop	The loop
+ * @param[out]	vars	The outer variables referenced in the loop
+ * @return	true if the loop's outer variables may be promoted
+ */
+static bool promotable(Editor& ed, const vector<Editor::Node>& nodes, const Loop& loop, vector<Var>& vars) {
+	auto pos = positions(nodes);
+	const auto first = pos[loop.head], last = pos[loop.back];
+	vector<Var> pinned;							// For loop variables
+
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		const auto n = nodes[i];
+		const auto op = ed[n].op;
+		const bool inside = first <= i && i <= last;
+
+		if (!inside) {							// Branches into the loop, other than to head?
+			if (jump(op) && pos.count(ed.target(n)))
+				if (pos[ed.target(n)] > first && pos[ed.target(n)] <= last)
+					return false;
+
+		} else if (OpCode::Call == op || OpCode::LCall == op || OpCode::Ret == op || OpCode::Retf == op)
+			return false;
+
+		else if (OpCode::ForNext == op) {
+			Var var;
+			if (!forVar(ed, n, var))
+				return false;
+			pinned.push_back(var);
+
+		} else if (OpCode::PushVar == op && ed[n].level > 0) {
+			const auto next = ed[ed.next(n)].op;
+			if (OpCode::Eval != next && OpCode::Assign != next)
+				return false;
+
+			const Var var { ed[n].level, ed[n].addr.integer() };
+			if (find(vars.begin(), vars.end(), var) == vars.end())
+				vars.push_back(var);
+		}
+	}
+
+	for (const auto& var : pinned)
+		vars.erase(remove(vars.begin(), vars.end(), var), vars.end());
+
+	return !vars.empty();
+}
+
+/**
+ * @param	prog	The program to optimize
+ */
+void ScalarPromote::operator()(Program& prog) {
+	Editor ed(prog);
+
+	for (size_t s = 0; s < prog.subrs.size(); ++s) {
+		set<pair<Editor::Node, Editor::Node>> tried;	// Loops already considered
+		vector<Loop> promoted;
+
+		for (;;) {
+			auto nodes = body(ed, s);
+			auto pos = positions(nodes);
+
+			// Find the outermost loop not yet tried, and not within a promoted loop...
+
+			Loop loop { Editor::none, Editor::none };
+			vector<Var> vars;
+			for (const auto& l : loops(ed, nodes)) {
+				if (!tried.insert({ l.head, l.back }).second)
+					continue;
+
+				bool within = false;
+				for (const auto& p : promoted)
+					within = within || (pos[p.head] <= pos[l.head] && pos[l.back] <= pos[p.back]);
+
+				vars.clear();
+				if (!within && promotable(ed, nodes, l, vars)) {
+					loop = l;
+					break;
+				}
+			}
+
+			if (Editor::none == loop.head)
+				break;
+			promoted.push_back(loop);
+
+			set<Editor::Node> region;			// The loop, before we add to it...
+			for (auto i = pos[loop.head]; i <= pos[loop.back]; ++i)
+				region.insert(nodes[i]);
+
+			// Allocate a local for each variable, load them ahead of the loop, and redirect
+			// branches from outside of the loop to the loads...
+
+			vector<Datum::Integer>	temps;
+			vector<bool>			written(vars.size(), false);
+			Editor::Node			preheader = Editor::none;
+			for (const auto& var : vars) {
+				const auto t = allocLocal(ed, s);
+				temps.push_back(t);
+
+				const auto n = ed.insert(loop.head, Instr(OpCode::PushVar, var.first, var.second));
+				ed.insert(loop.head, Instr(OpCode::Eval));
+				ed.insert(loop.head, Instr(OpCode::PushVar, 0, t));
+				ed.insert(loop.head, Instr(OpCode::Assign));
+				if (Editor::none == preheader) preheader = n;
+			}
+
+			for (auto n : nodes)
+				if (!region.count(n) && jump(ed[n].op) && ed.target(n) == loop.head)
+					ed.target(n, preheader);
+
+			// Replace references within the loop, noting exits from the loop
+
+			vector<Editor::Node>	exits;			// Exit targets
+			for (auto n : region) {
+				auto& instr = ed[n];
+				if (OpCode::PushVar == instr.op && instr.level > 0) {
+					const size_t i = find(vars.begin(), vars.end(), Var{ instr.level, instr.addr.integer() }) - vars.begin();
+					if (i == vars.size())
+						continue;					// A pinned for loop variable
+					if (OpCode::Assign == ed[ed.next(n)].op)
+						written[i] = true;
+					instr.level = 0;
+					instr.addr = temps[i];
+
+				} else if (jump(instr.op) && !region.count(ed.target(n)))
+					if (find(exits.begin(), exits.end(), ed.target(n)) == exits.end())
+						exits.push_back(ed.target(n));
+			}
+
+			if (find(written.begin(), written.end(), true) == written.end())
+				continue;							// Nothing to store back
+
+			// Store written variables back on each exit, via a landing pad following the loop. If
+			// the loop can fall out the bottom, the pad for the following instruction goes first.
+
+			const auto after = ed.next(loop.back);
+			const bool falls = OpCode::Jump != ed[loop.back].op;
+			const auto i = find(exits.begin(), exits.end(), after);
+			const bool exitsAfter = i != exits.end();
+			if (exitsAfter) exits.erase(i);
+			if (falls)
+				exits.insert(exits.begin(), after);
+			else if (exitsAfter)
+				exits.push_back(after);
+
+			for (size_t e = 0; e < exits.size(); ++e) {
+				Editor::Node pad = Editor::none;
+				for (size_t v = 0; v < vars.size(); ++v)
+					if (written[v]) {
+						const auto n = ed.insert(after, Instr(OpCode::PushVar, 0, temps[v]));
+						ed.insert(after, Instr(OpCode::Eval));
+						ed.insert(after, Instr(OpCode::PushVar, vars[v].first, vars[v].second));
+						ed.insert(after, Instr(OpCode::Assign));
+						if (Editor::none == pad) pad = n;
+					}
+
+				if (e + 1 < exits.size() || exits[e] != after)
+					ed.insert(after, Instr(OpCode::Jump), exits[e]);
+
+				for (auto n : region)
+					if (jump(ed[n].op) && ed.target(n) == exits[e])
+						ed.target(n, pad);
+			}
+		}
+	}
+
+	ed.commit();
+}
+
+/************************************************************************************************
+ *	class ConvertElim
+ ************************************************************************************************/
+
+/**
+ * Find the operands of ITOR2; the value it converts, and the value above it.
+ * @param		ed		The program
+ * @param		prog	The program's subroutines
+ * @param		subrs	Subroutine entry nodes to subroutine indexes
+ * @param		n		The ITOR2
+ * @param[out]	lhs		The first instruction of the converted operand
+ * @param[out]	rhs		The first instruction of the operand above it
+ * @return	false if the operands couldn't be found
+ */
+static bool itor2Operands(	Editor&								ed,
+							const Program&						prog,
+							const map<Editor::Node, size_t>&	subrs,
+							Editor::Node						n,
+							Editor::Node&						lhs,
+							Editor::Node&						rhs) {
+	vector<Editor::Node> starts;
+	if (!actuals(ed, prog, subrs, n, 2, starts))
+		return false;
+
+	lhs = starts[0];
+	rhs = starts[1];
+	return true;
+}
+
+/// A conversion of a variable's value; the variable, and ITOR or RTOI
+typedef pair<Var, OpCode>	Conversion;
+
+/**
+ * Find the conversions of loop invariant variables within a loop that is only entered via its
+ * head, and makes no calls. Each conversion is the node to erase, and the variable reference
+ * whose value it converts.
+ * @param		ed		The program
+ * @param		prog	The program's subroutines
+ * @param		nodes	The subroutine body
+ * @param		loop	The loop
+ * @param[out]	convs	The conversions, and their nodes; the conversion and the reference
+ * @return	true if the loop has any loop invariant conversions
+ */
+static bool invariantConversions(
+	Editor&												ed,
+	const Program&										prog,
+	const vector<Editor::Node>&							nodes,
+	const Loop&											loop,
+	map<Conversion, vector<pair<Editor::Node, Editor::Node>>>&	convs) {
+	auto pos = positions(nodes);
+	const auto first = pos[loop.head], last = pos[loop.back];
+	set<Var> written;
+
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		const auto n = nodes[i];
+		const auto op = ed[n].op;
+		const bool inside = first <= i && i <= last;
+
+		if (!inside) {							// Branches into the loop, other than to head?
+			if (jump(op) && pos.count(ed.target(n)))
+				if (pos[ed.target(n)] > first && pos[ed.target(n)] <= last)
+					return false;
+
+		} else if (OpCode::Call == op || OpCode::LCall == op || OpCode::Ret == op || OpCode::Retf == op)
+			return false;
+
+		else if (OpCode::ForNext == op) {		// Writes the loop variable
+			Var var;
+			if (!forVar(ed, n, var))
+				return false;
+			written.insert(var);
+
+		} else if (OpCode::PushVar == op && OpCode::Eval != ed[ed.next(n)].op)
+			written.insert({ ed[n].level, ed[n].addr.integer() });
+	}
+
+	const auto subrs = callees(ed, prog);
+	for (auto i = first; i <= last; ++i) {
+		const auto n = nodes[i];
+		const auto op = ed[n].op;
+
+		Editor::Node ref = Editor::none;		// pushvar v, eval...
+		if (OpCode::ITOR == op || OpCode::RTOI == op) {
+			const auto e = ed.prev(n);
+			if (!ed.targeted(n) && OpCode::Eval == ed[e].op && !ed.targeted(e) && OpCode::PushVar == ed[ed.prev(e)].op)
+				ref = ed.prev(e);
+
+		} else if (OpCode::ITOR2 == op) {
+			Editor::Node lhs, rhs;
+			if (	itor2Operands(ed, prog, subrs, n, lhs, rhs)
+				&&	OpCode::PushVar == ed[lhs].op && OpCode::Eval == ed[ed.next(lhs)].op && ed.next(ed.next(lhs)) == rhs)
+				ref = lhs;
+		}
+
+		if (Editor::none == ref || pos[ref] < first)
+			continue;
+
+		const Var var { ed[ref].level, ed[ref].addr.integer() };
+		if (!written.count(var))
+			convs[{ var, OpCode::RTOI == op ? OpCode::RTOI : OpCode::ITOR }].push_back({ n, ref });
+	}
+
+	return !convs.empty();
+}
+
+/**
+ * @param	prog	The program to optimize
+ */
+void ConvertElim::operator()(Program& prog) {
+	Editor ed(prog);
+
+	// Convert constants converted by ITOR2, below some other expression...
+
+	const auto subrs = callees(ed, prog);
+	for (auto n = ed.begin(); n != Editor::none; ) {
+		const auto next = ed.next(n);
+		Editor::Node lhs, rhs;
+		Datum result;
+
+		if (	OpCode::ITOR2 == ed[n].op
+			&&	itor2Operands(ed, prog, subrs, n, lhs, rhs)
+			&&	OpCode::Push == ed[lhs].op && ed.next(lhs) == rhs
+			&&	fold(OpCode::ITOR, ed[lhs].addr, result)) {
+			ed[lhs].addr = result;
+			ed.erase(n);
+		}
+
+		n = next;
+	}
+
+	// Hoist the conversions of loop invariant variables out of loops, outermost first, into a
+	// new local, converted once ahead of the loop...
+
+	for (size_t s = 0; s < prog.subrs.size(); ++s) {
+		set<pair<Editor::Node, Editor::Node>> tried;	// Loops already considered
+
+		for (;;) {
+			auto nodes = body(ed, s);
+
+			Loop loop { Editor::none, Editor::none };
+			map<Conversion, vector<pair<Editor::Node, Editor::Node>>> convs;
+			for (const auto& l : loops(ed, nodes))
+				if (tried.insert({ l.head, l.back }).second && invariantConversions(ed, prog, nodes, l, convs)) {
+					loop = l;
+					break;
+				}
+
+			if (Editor::none == loop.head)
+				break;
+
+			auto pos = positions(nodes);
+			Editor::Node preheader = Editor::none;
+			for (const auto& c : convs) {
+				const auto& var = c.first.first;
+				const auto t = allocLocal(ed, s);
+
+				const auto n = ed.insert(loop.head, Instr(OpCode::PushVar, var.first, var.second));
+				ed.insert(loop.head, Instr(OpCode::Eval));
+				ed.insert(loop.head, Instr(c.first.second));
+				ed.insert(loop.head, Instr(OpCode::PushVar, 0, t));
+				ed.insert(loop.head, Instr(OpCode::Assign));
+				if (Editor::none == preheader) preheader = n;
+
+				for (const auto& use : c.second) {		// Evaluate the local, unconverted
+					ed[use.second] = Instr(OpCode::PushVar, 0, t);
+					ed.erase(use.first);
+				}
+			}
+
+			for (auto n : nodes)
+				if (	jump(ed[n].op) && ed.target(n) == loop.head
+					&&	(pos[n] < pos[loop.head] || pos[n] > pos[loop.back]))
+					ed.target(n, preheader);
+		}
+	}
+
+	ed.commit();
+}
+
+/************************************************************************************************
+ *	class LoopUnroll
+ ************************************************************************************************/
+
+/// A counted loop; while i < limit do begin ...; i = i + 1 end
+struct CountedLoop {
+	Var						var;				///< The counter, i
+	vector<Editor::Node>	limit;				///< Pushes the limit; a constant or a variable
+	OpCode					test;				///< LT or LTE
+	vector<Editor::Node>	body;				///< The body, ending with the increment
+};
+
+/**
+ * @param	ed		The program
+ * @param	n		An instruction
+ * @param	var		A variable
+ * @return	true if n is a reference to var
+ */
+static bool refers(Editor& ed, Editor::Node n, const Var& var) {
+	return OpCode::PushVar == ed[n].op && var == Var{ ed[n].level, ed[n].addr.integer() };
+}
+
+/**
+ * Is loop a counted loop; a while loop testing a variable against a loop invariant limit, whose
+ * body, which makes no calls, ends by incrementing the variable, and doesn't otherwise write it?
+ * @param		ed		The program
+ * @param		nodes	The subroutine body
+ * @param		loop	The loop
+ * @param		maxBody	The largest body to consider
+ * @param[out]	cl		The counted loop
+ * @return	true if loop is a counted loop
+ */
+static bool counted(	Editor&						ed,
+						const vector<Editor::Node>&	nodes,
+						const Loop&					loop,
+						size_t						maxBody,
+						CountedLoop&				cl) {
+	if (OpCode::Jump != ed[loop.back].op)
+		return false;
+
+	// head: pushvar i, eval, { push c | pushvar w, eval }, { lt | lte }, jneq exit
+
+	auto n = loop.head;
+	if (OpCode::PushVar != ed[n].op || OpCode::Eval != ed[ed.next(n)].op)
+		return false;
+	cl.var = { ed[n].level, ed[n].addr.integer() };
+
+	n = ed.next(ed.next(n));
+	cl.limit = { n };
+	if (OpCode::PushVar == ed[n].op && !refers(ed, n, cl.var) && OpCode::Eval == ed[ed.next(n)].op)
+		cl.limit.push_back(n = ed.next(n));
+	else if (OpCode::Push != ed[n].op || Datum::Kind::Integer != ed[n].addr.kind())
+		return false;
+
+	n = ed.next(n);
+	cl.test = ed[n].op;
+	if (OpCode::LT != cl.test && OpCode::LTE != cl.test)
+		return false;
+
+	const auto jneq = ed.next(n);
+	if (OpCode::JNEQ != ed[jneq].op || ed.target(jneq) != ed.next(loop.back))
+		return false;
+
+	cl.body.clear();
+	for (n = ed.next(jneq); n != loop.back; n = ed.next(n))
+		cl.body.push_back(n);
+	if (cl.body.size() < 6 || cl.body.size() > maxBody)
+		return false;
+
+	// ... i = i + 1 ...
+
+	const auto inc = cl.body.size() - 6;
+	const vector<OpCode> incOps
+		{ OpCode::PushVar, OpCode::Eval, OpCode::Push, OpCode::Add, OpCode::PushVar, OpCode::Assign };
+	for (size_t j = 0; j < incOps.size(); ++j)
+		if (ed[cl.body[inc + j]].op != incOps[j])
+			return false;
+	if (	!refers(ed, cl.body[inc], cl.var) || !refers(ed, cl.body[inc + 4], cl.var)
+		||	!same(ed[cl.body[inc + 2]].addr, Datum(1)))
+		return false;
+
+	// The body mustn't call, or return, branch out, or write i, or the limit...
+
+	const set<Editor::Node> inside(cl.body.begin(), cl.body.end());
+	for (size_t j = 0; j < inc; ++j) {
+		const auto m = cl.body[j];
+		switch (ed[m].op) {
+		case OpCode::Call:	case OpCode::LCall:	case OpCode::Ret:	case OpCode::Retf:
+		case OpCode::LRet:	case OpCode::Enter:	case OpCode::Halt:
+			return false;
+
+		case OpCode::Jump:	case OpCode::JNEQ:	case OpCode::ForTest:	case OpCode::ForNext:
+			if (!inside.count(ed.target(m)))
+				return false;
+			break;
+
+		case OpCode::PushVar:
+			if (	(refers(ed, m, cl.var) || (2 == cl.limit.size() && refers(ed, m, { ed[cl.limit[0]].level, ed[cl.limit[0]].addr.integer() })))
+				&&	OpCode::Eval != ed[ed.next(m)].op)
+				return false;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	// ... and nothing else may branch into the loop, other than to its head.
+
+	auto pos = positions(nodes);
+	for (auto m : nodes) {
+		if (!isBranch(ed[m].op) || !pos.count(ed.target(m)))
+			continue;
+		const auto t = pos[ed.target(m)];
+		if (t > pos[loop.head] && t <= pos[loop.back] && (pos[m] < pos[loop.head] || pos[m] > pos[loop.back]))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * @param	prog	The program to optimize
+ */
+void LoopUnroll::operator()(Program& prog) {
+	if (factor < 2)
+		return;
+
+	Editor ed(prog);
+	const Datum::Integer k = factor;
+
+	for (size_t s = 0; s < prog.subrs.size(); ++s) {
+		set<pair<Editor::Node, Editor::Node>> tried;	// Loops already considered
+
+		for (;;) {
+			auto nodes = body(ed, s);
+
+			// Find the innermost counted loop not yet tried...
+
+			auto ls = loops(ed, nodes);
+			Loop loop { Editor::none, Editor::none };
+			CountedLoop cl;
+			for (auto l = ls.rbegin(); l != ls.rend(); ++l)
+				if (tried.insert({ l->head, l->back }).second && counted(ed, nodes, *l, maxBody, cl)) {
+					loop = *l;
+					break;
+				}
+
+			if (Editor::none == loop.head)
+				break;
+
+			if (1 == cl.limit.size() && ed[cl.limit[0]].addr.integer() < numeric_limits<Datum::Integer>::min() + k - 1)
+				continue;						// limit - (k - 1) would overflow
+
+			// Ahead of the loop, which remains to run the remaining iterations:
+			//
+			// 		u:	pushvar i, eval, limit - (k - 1), { lt | lte }, jneq head
+			//			k * body
+			//			jump u
+			//
+			// A variable limit is checked once, on entry, so that limit - (k - 1) can't overflow:
+			//
+			//		g:	pushvar w, eval, push min + (k - 1), gte, jneq head
+
+			const auto head = loop.head;
+			Editor::Node entry = Editor::none;
+			if (2 == cl.limit.size()) {
+				entry = copy(ed, cl.limit, head)[cl.limit[0]];
+				ed.insert(head, Instr(OpCode::Push, 0, numeric_limits<Datum::Integer>::min() + (k - 1)));
+				ed.insert(head, Instr(OpCode::GTE));
+				ed.insert(head, Instr(OpCode::JNEQ), head);
+			}
+
+			const auto u = ed.insert(head, Instr(OpCode::PushVar, cl.var.first, cl.var.second));
+			if (Editor::none == entry) entry = u;
+			ed.insert(head, Instr(OpCode::Eval));
+			if (1 == cl.limit.size())
+				ed.insert(head, Instr(OpCode::Push, 0, ed[cl.limit[0]].addr.integer() - (k - 1)));
+			else {
+				copy(ed, cl.limit, head);
+				ed.insert(head, Instr(OpCode::Push, 0, k - 1));
+				ed.insert(head, Instr(OpCode::Sub));
+			}
+			ed.insert(head, Instr(cl.test));
+			ed.insert(head, Instr(OpCode::JNEQ), head);
+
+			for (Datum::Integer j = 0; j < k; ++j)
+				copy(ed, cl.body, head);
+			tried.insert({ u, ed.insert(head, Instr(OpCode::Jump), u) });
+
+			// Enter via the unrolled loop
+
+			auto pos = positions(nodes);
+			for (auto n : nodes)
+				if (	jump(ed[n].op) && ed.target(n) == head
+					&&	(pos[n] < pos[head] || pos[n] > pos[loop.back]))
+					ed.target(n, entry);
+			if (ed.entry(s) == head)
+				ed.entry(s, entry);
+		}
+	}
+
+	ed.commit();
+}
+
+/************************************************************************************************
+ *	class DeadStore
+ ************************************************************************************************/
+
+/// A set of frame slots; parameter and local variable offsets
+typedef set<Datum::Integer>	Slots;
+
+/**
+ * @param		ed		The program
+ * @param		n		An instruction
+ * @param[out]	slot	The parameter, or local, n reads or writes
+ * @return	true if n is an Eval, or Assign, of one of the subroutines parameters or locals
+ */
+static bool slotRef(Editor& ed, Editor::Node n, Datum::Integer& slot) {
+	if (OpCode::Eval != ed[n].op && OpCode::Assign != ed[n].op)
+		return false;
+
+	const auto p = ed.prev(n);
+	if (Editor::none == p || OpCode::PushVar != ed[p].op || 0 != ed[p].level)
+		return false;
+
+	slot = ed[p].addr.integer();
+	return slot < 0 || slot >= FrameSize;
+}
+
+/**
+ * Find the slots of subroutine s that can't be tracked; those that nested subroutines reference,
+ * and those whose address is used other than to read or write them.
+ * @param	ed		The program
+ * @param	prog	The program's subroutines
+ * @param	s		The subroutine
+ * @return	The pinned slots
+ */
+static Slots pinned(Editor& ed, const Program& prog, size_t s) {
+	Slots pins;
+
+	for (auto n : body(ed, s)) {
+		const auto& instr = ed[n];
+		if (OpCode::PushVar == instr.op && 0 == instr.level) {
+			const auto next = ed[ed.next(n)].op;
+			if (OpCode::Eval != next && OpCode::Assign != next)
+				pins.insert(instr.addr.integer());
+		}
+	}
+
+	for (const auto& d : descendants(prog, s))
+		for (auto n : body(ed, d.first)) {
+			const auto& instr = ed[n];
+			if (OpCode::PushVar == instr.op && d.second == instr.level)
+				pins.insert(instr.addr.integer());
+		}
+
+	return pins;
+}
+
+/**
+ * Compute the slots that are live, i.e., may be read before they're written, following each
+ * instruction of a subroutine body.
+ * @param	ed		The program
+ * @param	nodes	The subroutine body
+ * @return	The live slots following each instruction in nodes
+ */
+static vector<Slots> liveness(Editor& ed, const vector<Editor::Node>& nodes) {
+	auto pos = positions(nodes);
+	vector<Slots> in(nodes.size()), out(nodes.size());
+
+	for (bool changed = true; changed; ) {
+		changed = false;
+
+		for (auto i = nodes.size(); i-- > 0; ) {
+			const auto n = nodes[i];
+			const auto op = ed[n].op;
+
+			Slots live;
+			if (jump(op))
+				if (pos.count(ed.target(n)))
+					live = in[pos[ed.target(n)]];
+
+			if (OpCode::JTab == op)						// Any of the table's jumps
+				for (size_t j = 1; j <= ed[n].addr.uinteger() && i + j + 1 < nodes.size(); ++j)
+					live.insert(in[i + j + 1].begin(), in[i + j + 1].end());
+
+			if (	OpCode::Jump != op && OpCode::Ret != op && OpCode::Retf != op
+				&&	OpCode::LRet != op && OpCode::Halt != op && i + 1 < nodes.size())
+				live.insert(in[i + 1].begin(), in[i + 1].end());
+
+			if (live != out[i]) {
+				out[i] = live;
+				changed = true;
+			}
+
+			Datum::Integer slot;
+			if (slotRef(ed, n, slot)) {
+				if (OpCode::Eval == op)
+					live.insert(slot);
+				else
+					live.erase(slot);
+			}
+
+			if (live != in[i]) {
+				in[i] = live;
+				changed = true;
+			}
+		}
+	}
+
+	return out;
+}
+
+/**
+ * @param	ed		The program
+ * @param	first	The first instruction of an expression
+ * @param	last	The last instruction of the expression
+ * @return	true if evaluating the expression can't have any effect other than its value
+ */
+static bool sideEffectFree(Editor& ed, Editor::Node first, Editor::Node last) {
+	for (auto n = first; ; n = ed.next(n)) {
+		const auto op = ed[n].op;
+		if (OpCode::Call == op || OpCode::LCall == op)
+			return false;
+
+		else if (OpCode::Div == op || OpCode::Rem == op) {	// Might divide by zero?
+			const auto& d = ed[ed.prev(n)];
+			if (OpCode::Push != d.op || Datum::Kind::Integer != d.addr.kind() || 0 == d.addr.integer())
+				return false;
+		}
+
+		if (n == last) break;
+	}
+
+	return true;
+}
+
+/**
+ * @param	prog	The program to optimize
+ */
+void DeadStore::operator()(Program& prog) {
+	Editor ed(prog);
+
+	// The outer blocks variables are the programs results, so main is left alone
+
+	for (size_t s = 1; s < prog.subrs.size(); ++s) {
+		const auto pins = pinned(ed, prog, s);
+
+		// Remove stores to slots that aren't live, along with the value, until there are no more;
+		// removing a store may leave others dead...
+
+		for (bool changed = true; changed; ) {
+			changed = false;
+
+			const auto subrs = callees(ed, prog);
+			const auto nodes = body(ed, s);
+			const auto live = liveness(ed, nodes);
+			vector<pair<Editor::Node, Editor::Node>> dead;
+
+			for (size_t i = 0; i < nodes.size(); ++i) {
+				const auto n = nodes[i];
+				Datum::Integer slot;
+				if (OpCode::Assign != ed[n].op || !slotRef(ed, n, slot) || pins.count(slot) || live[i].count(slot))
+					continue;
+
+				vector<Editor::Node> starts;
+				if (actuals(ed, prog, subrs, ed.prev(n), 1, starts) && sideEffectFree(ed, starts[0], n))
+					dead.push_back({ starts[0], n });
+			}
+
+			for (const auto& d : dead) {
+				for (auto n = d.first; ; ) {
+					const auto next = ed.next(n);
+					ed.erase(n);
+					if (n == d.second) break;
+					n = next;
+				}
+				changed = true;
+			}
+		}
+
+		// Remove locals that are no longer referenced, renumbering the rest...
+
+		const auto e = ed.entry(s);
+		if (OpCode::Enter != ed[e].op)
+			continue;
+
+		const Datum::Integer nLocals = ed[e].addr.integer();
+		Slots used = pins;
+		for (auto n : body(ed, s))
+			if (OpCode::PushVar == ed[n].op && 0 == ed[n].level)
+				used.insert(ed[n].addr.integer());
+
+		vector<Datum::Integer> offsets(nLocals);
+		Datum::Integer k = 0;
+		for (Datum::Integer j = 0; j < nLocals; ++j)
+			offsets[j] = used.count(FrameSize + j) ? FrameSize + k++ : FrameSize + j;
+		if (k == nLocals)
+			continue;
+
+		auto renumber = [&](Editor::Node n, int level) {
+			auto& instr = ed[n];
+			const auto j = instr.addr.integer() - FrameSize;
+			if (OpCode::PushVar == instr.op && level == instr.level && j >= 0 && j < nLocals)
+				instr.addr = offsets[j];
+		};
+
+		for (auto n : body(ed, s))
+			renumber(n, 0);
+		for (const auto& d : descendants(prog, s))
+			for (auto n : body(ed, d.first))
+				renumber(n, d.second);
+
+		if (k > 0)
+			ed[e].addr = k;
+		else
+			ed.erase(e);
+	}
+
+	ed.commit();
+}
+
+/************************************************************************************************
+ *	class SlotColor
+ ************************************************************************************************/
+
+/**
+ * @param	prog	The program to optimize
+ */
+void SlotColor::operator()(Program& prog) {
+	Editor ed(prog);
+
+	for (size_t s = 1; s < prog.subrs.size(); ++s) {	// main's variables are the results
+		const auto e = ed.entry(s);
+		if (OpCode::Enter != ed[e].op)
+			continue;
+
+		const Datum::Integer nLocals = ed[e].addr.integer();
+		const auto nodes = body(ed, s);
+		const auto live = liveness(ed, nodes);
+		const auto pins = pinned(ed, prog, s);
+
+		// Locals interfere if one is live where the other is written. Pinned locals, and those
+		// that may be read before they're written, interfere with every other local.
+
+		vector<set<Datum::Integer>> interferes(nLocals);
+		vector<bool> fixed(nLocals, false);
+		for (Datum::Integer j = 0; j < nLocals; ++j)
+			fixed[j] = pins.count(FrameSize + j) > 0;
+		for (auto l : live[0])					// Live following the Enter
+			if (l >= FrameSize)
+				fixed[l - FrameSize] = true;
+
+		for (size_t i = 0; i < nodes.size(); ++i) {
+			Datum::Integer slot;
+			if (OpCode::Assign != ed[nodes[i]].op || !slotRef(ed, nodes[i], slot) || slot < FrameSize)
+				continue;
+
+			for (auto l : live[i])
+				if (l >= FrameSize && l != slot) {
+					interferes[slot - FrameSize].insert(l - FrameSize);
+					interferes[l - FrameSize].insert(slot - FrameSize);
+				}
+		}
+
+		// Color the locals, in order, with the lowest slot not taken by a local it interferes
+		// with...
+
+		vector<Datum::Integer> color(nLocals, -1);
+		Datum::Integer nColors = 0;
+		for (Datum::Integer j = 0; j < nLocals; ++j) {
+			set<Datum::Integer> taken;
+			for (Datum::Integer k = 0; k < j; ++k)
+				if (fixed[j] || fixed[k] || interferes[j].count(k))
+					taken.insert(color[k]);
+
+			while (taken.count(++color[j]))
+				;
+			nColors = max(nColors, color[j] + 1);
+		}
+
+		if (nColors == nLocals)
+			continue;
+
+		auto renumber = [&](Editor::Node n, int level) {
+			auto& instr = ed[n];
+			const auto j = instr.addr.integer() - FrameSize;
+			if (OpCode::PushVar == instr.op && level == instr.level && j >= 0 && j < nLocals)
+				instr.addr = FrameSize + color[j];
+		};
+
+		for (auto n : nodes)
+			renumber(n, 0);
+		for (const auto& d : descendants(prog, s))
+			for (auto n : body(ed, d.first))
+				renumber(n, d.second);
+
+		ed[e].addr = nColors;
+	}
+
+	ed.commit();
+}
+
+/************************************************************************************************
+ *	class DivCheck
+ ************************************************************************************************/
+
+/// A range of integer values, lo..hi; where the limits of Datum::Integer are unbounded
+typedef pair<long long, long long>	Range;
+
+/// The range of each slot, where slots not present may hold any value
+typedef map<Datum::Integer, Range>	Ranges;
+
+static const long long	minRange = numeric_limits<Datum::Integer>::min();	///< Unbounded below
+static const long long	maxRange = numeric_limits<Datum::Integer>::max();	///< Unbounded above
+
+/**
+ * @param	r	A range
+ * @param	c	A constant to add to r
+ * @return	r + c; unbounded limits remain so, as do limits that overflow
+ */
+static Range offset(Range r, long long c) {
+	if (r.first != minRange)
+		r.first = r.first + c <= minRange || r.first + c >= maxRange ? minRange : r.first + c;
+	if (r.second != maxRange)
+		r.second = r.second + c <= minRange || r.second + c >= maxRange ? maxRange : r.second + c;
+	return r;
+}
+
+/**
+ * Narrow a slot's range by the outcome of a comparison with a constant
+ * @param	ranges	The slot ranges
+ * @param	slot	The slot compared
+ * @param	op		The comparison; slot op c
+ * @param	c		The constant
+ * @param	taken	The outcome of the comparison
+ */
+static void narrow(Ranges& ranges, Datum::Integer slot, OpCode op, long long c, bool taken) {
+	Range r = ranges.count(slot) ? ranges[slot] : Range{ minRange, maxRange };
+
+	if (!taken)								// Compare by the opposite
+		switch (op) {
+		case OpCode::LT:	op = OpCode::GTE;	break;
+		case OpCode::LTE:	op = OpCode::GT;	break;
+		case OpCode::GT:	op = OpCode::LTE;	break;
+		case OpCode::GTE:	op = OpCode::LT;	break;
+		case OpCode::EQU:	op = OpCode::NEQU;	break;
+		default:			op = OpCode::EQU;	break;
+		}
+
+	switch (op) {
+	case OpCode::LT:	r.second = min(r.second, c - 1);			break;
+	case OpCode::LTE:	r.second = min(r.second, c);				break;
+	case OpCode::GT:	r.first = max(r.first, c + 1);				break;
+	case OpCode::GTE:	r.first = max(r.first, c);					break;
+	case OpCode::EQU:	r = { max(r.first, c), min(r.second, c) };	break;
+	default:
+		if (r.first == c)	++r.first;
+		if (r.second == c)	--r.second;
+		break;
+	}
+
+	ranges[slot] = r;
+}
+
+/**
+ * Match the instructions ahead of n, none of which, other than the first, may be branch targets.
+ * @param	ed		The program
+ * @param	n		The instruction following the match
+ * @param	ops		The operations to match, in order
+ * @param	nodes	The matching instructions
+ * @return	true if the instructions ahead of n match ops
+ */
+static bool precedes(Editor& ed, Editor::Node n, const vector<OpCode>& ops, vector<Editor::Node>& nodes) {
+	nodes.assign(ops.size(), Editor::none);
+
+	for (auto i = ops.size(); i-- > 0; ) {
+		if (ed.targeted(n))
+			return false;
+		n = ed.prev(n);
+		if (Editor::none == n || ed[n].op != ops[i])
+			return false;
+		nodes[i] = n;
+	}
+
+	return true;
+}
+
+/**
+ * Compute the ranges of a subroutine's integer slots ahead of each instruction, from assignments
+ * of constants, increments by constants, and comparisons with constants. Slot ranges that are
+ * still growing where a branch back joins them are made unbounded, so that loops converge.
+ * @param	ed		The program
+ * @param	nodes	The subroutine body
+ * @param	pins	The subroutine's pinned slots
+ * @return	The slot ranges ahead of each instruction in nodes, if reachable
+ */
+static vector<pair<bool, Ranges>> ranges(Editor& ed, const vector<Editor::Node>& nodes, const Slots& pins) {
+	auto pos = positions(nodes);
+	vector<pair<bool, Ranges>> in(nodes.size(), { false, Ranges() });
+	in[0].first = true;
+
+	// Join state into the state ahead of node i, returning true if it changed
+
+	auto join = [&](size_t i, const Ranges& state, bool back) {
+		auto& to = in[i];
+		if (!to.first) {
+			to = { true, state };
+			return true;
+		}
+
+		Ranges joined;
+		for (const auto& r : to.second) {
+			const auto j = state.find(r.first);
+			if (j == state.end())
+				continue;
+
+			Range x { min(r.second.first, j->second.first), max(r.second.second, j->second.second) };
+			if (back && x.first < r.second.first)	x.first = minRange;
+			if (back && x.second > r.second.second)	x.second = maxRange;
+			joined[r.first] = x;
+		}
+
+		if (joined == to.second)
+			return false;
+		to.second = joined;
+		return true;
+	};
+
+	vector<bool> pending(nodes.size(), false);
+	pending[0] = true;
+	for (bool changed = true; changed; ) {
+		changed = false;
+
+		for (size_t i = 0; i < nodes.size(); ++i) {
+			if (!pending[i] || !in[i].first)
+				continue;
+			pending[i] = false;
+
+			const auto n = nodes[i];
+			const auto op = ed[n].op;
+			auto state = in[i].second;
+			vector<Editor::Node> m;
+
+			Datum::Integer slot;
+			if (OpCode::Assign == op && slotRef(ed, n, slot) && !pins.count(slot)) {
+				const auto p = ed.prev(n);
+				Datum::Integer from;
+
+				state.erase(slot);
+				if (precedes(ed, p, { OpCode::Push }, m) && Datum::Kind::Integer == ed[m[0]].addr.kind()) {
+					const long long c = ed[m[0]].addr.integer();
+					state[slot] = { c, c };
+
+				} else if (	(precedes(ed, p, { OpCode::PushVar, OpCode::Eval, OpCode::Push, OpCode::Add }, m)
+						||	 precedes(ed, p, { OpCode::PushVar, OpCode::Eval, OpCode::Push, OpCode::Sub }, m))
+						&&	slotRef(ed, m[1], from) && in[i].second.count(from)
+						&&	Datum::Kind::Integer == ed[m[2]].addr.kind()) {
+					const long long c = ed[m[2]].addr.integer();
+					state[slot] = offset(in[i].second[from], OpCode::Add == ed[m[3]].op ? c : -c);
+				}
+			}
+
+			// Successors; conditional branches on a slot compared with a constant narrow its
+			// range along each edge
+
+			Ranges taken = state, fallen = state;
+			if (	OpCode::JNEQ == op
+				&&	precedes(ed, n, { OpCode::PushVar, OpCode::Eval, OpCode::Push, ed[ed.prev(n)].op }, m)
+				&&	slotRef(ed, m[1], slot) && !pins.count(slot)
+				&&	Datum::Kind::Integer == ed[m[2]].addr.kind()) {
+				const auto cmp = ed[m[3]].op;
+				if (	OpCode::LT == cmp || OpCode::LTE == cmp || OpCode::GT == cmp
+					||	OpCode::GTE == cmp || OpCode::EQU == cmp || OpCode::NEQU == cmp) {
+					narrow(fallen, slot, cmp, ed[m[2]].addr.integer(), true);
+					narrow(taken, slot, cmp, ed[m[2]].addr.integer(), false);
+				}
+			}
+
+			if (jump(op) && pos.count(ed.target(n))) {
+				const auto t = pos[ed.target(n)];
+				if (join(t, taken, t <= i)) {
+					pending[t] = true;
+					changed = true;
+				}
+			}
+
+			if (OpCode::JTab == op)						// Any of the table's jumps
+				for (size_t j = 1; j <= ed[n].addr.uinteger() && i + j + 1 < nodes.size(); ++j)
+					if (join(i + j + 1, state, false)) {
+						pending[i + j + 1] = true;
+						changed = true;
+					}
+
+			if (	OpCode::Jump != op && OpCode::Ret != op && OpCode::Retf != op
+				&&	OpCode::LRet != op && OpCode::Halt != op && i + 1 < nodes.size())
+				if (join(i + 1, fallen, false)) {
+					pending[i + 1] = true;
+					changed = true;
+				}
+		}
+	}
+
+	return in;
+}
+
+/**
+ * @param	prog	The program to optimize
+ */
+void DivCheck::operator()(Program& prog) {
+	Editor ed(prog);
+
+	for (size_t s = 0; s < prog.subrs.size(); ++s) {
+		const auto nodes = body(ed, s);
+		const auto in = ranges(ed, nodes, pinned(ed, prog, s));
+
+		for (size_t i = 0; i < nodes.size(); ++i) {
+			const auto n = nodes[i];
+			if (OpCode::Div != ed[n].op && OpCode::Rem != ed[n].op)
+				continue;
+
+			auto d = ed.prev(n);					// The divisor, ignoring conversions
+			while (!ed.targeted(ed.next(d)) && (OpCode::ITOR == ed[d].op || OpCode::ITOR2 == ed[d].op))
+				d = ed.prev(d);
+			if (ed.targeted(ed.next(d)))
+				continue;
+
+			bool nonzero = false;
+			const auto& divisor = ed[d].addr;
+			Datum::Integer slot;
+			if (OpCode::Push == ed[d].op)
+				nonzero = Datum::Kind::Real == divisor.kind() ? divisor.real() != 0 : divisor.integer() != 0;
+
+			else if (slotRef(ed, d, slot) && in[i].first && in[i].second.count(slot)) {
+				const auto& r = in[i].second.at(slot);
+				nonzero = r.first > 0 || r.second < 0;
+			}
+
+			if (nonzero)
+				ed[n].op = OpCode::Div == ed[n].op ? OpCode::DivNZ : OpCode::RemNZ;
+		}
+	}
+
+	ed.commit();
+}
+
+/************************************************************************************************
+ *	class LeafProc
+ ************************************************************************************************/
+
+/**
+ * @param	prog	The program to optimize
+ */
+void LeafProc::operator()(Program& prog) {
+	Editor ed(prog);
+	map<Editor::Node, size_t> leaves;			// Leaf entry points to subroutine indexes
+
+	for (size_t s = 1; s < prog.subrs.size(); ++s) {	// Leave main's frame alone
+		if (prog.subrs[s].function)
+			continue;
+
+		bool leaf = true;
+		for (auto n = ed.entry(s); leaf; n = ed.next(n)) {
+			const auto& instr = ed[n];
+			if (OpCode::Call == instr.op || OpCode::LCall == instr.op)
+				leaf = false;					// Not a leaf...
+
+			else if (OpCode::PushVar == instr.op)	// Only references its own locals or params
+				leaf = 0 == instr.level
+					&& (instr.addr.integer() < 0 || instr.addr.integer() >= FrameSize);
+
+			if (n == ed.exit(s)) break;
+		}
+
+		if (leaf)
+			leaves[ed.entry(s)] = s;
+	}
+
+	for (auto& leaf : leaves) {					// Adjust local offsets, and the return
+		const auto s = leaf.second;
+		for (auto n = ed.entry(s); ; n = ed.next(n)) {
+			auto& instr = ed[n];
+			if (OpCode::PushVar == instr.op && instr.addr.integer() >= FrameSize)
+				instr.addr = instr.addr.integer() - (FrameSize - LeafFrameSize);
+
+			else if (OpCode::Ret == instr.op)
+				instr.op = OpCode::LRet;
+
+			if (n == ed.exit(s)) break;
+		}
+	}
+
+	for (auto n = ed.begin(); n != Editor::none; n = ed.next(n))	// Call leaves via LCall
+		if (OpCode::Call == ed[n].op && leaves.count(ed.target(n))) {
+			ed[n].op = OpCode::LCall;
+			ed[n].level = 0;
+		}
+
+	ed.commit();
+}
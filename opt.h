@@ -0,0 +1,193 @@
+/** @file opt.h
+ *
+ * The PL/0C bytecode optimization passes.
+ *
+ * @author Randy Merkel, Slowly but Surly Software.
+ * @copyright  (c) 2017 Slowly but Surly Software. All rights reserved.
+ */
+
+#ifndef	OPT_H
+#define	OPT_H
+
+#include "pass.h"
+
+/** Interprocedural constant propagation
+ *
+ * Parameters that a subroutine only reads, and that every call site passes the same constant
+ * for, are replaced by that constant, and removed from the subroutine's frame. Groups of call
+ * sites that pass other constants call a specialized clone of the subroutine, with those
+ * parameters replaced instead; the largest group keeps the original if every group has a clone.
+ *
+ * Recursive subroutines, and subroutines with nested subroutines, are not cloned, and no more
+ * than maxClones are made of any one subroutine.
+ */
+class ConstProp : public Pass {
+public:
+	static const unsigned maxClones = 4;	///< Maximum number of clones per subroutine
+
+	ConstProp() : Pass("ipcp") {}		///< Constructor
+	void operator()(Program& prog);		///< Run the pass over prog
+};
+
+/** Constant folding
+ *
+ * Replaces unary and binary operations on constants, e.g., push 2, push 3, mul, with their
+ * result, e.g., push 6. Division by zero is left for the machine to report.
+ */
+class ConstFold : public Pass {
+public:
+	ConstFold() : Pass("fold") {}		///< Constructor
+	void operator()(Program& prog);		///< Run the pass over prog
+};
+
+/** Partial evaluation
+ *
+ * Calls to pure functions, i.e., functions that only reference their own frame and only call
+ * other pure subroutines, that pass only constants are evaluated by the compiler, via Interp,
+ * and replaced by a push of the result. Calls that don't return within budget machine cycles,
+ * or fail, are left for run time.
+ */
+class PartialEval : public Pass {
+public:
+	static const std::size_t budget = 10000;	///< Maximum machine cycles per call
+
+	PartialEval() : Pass("eval") {}		///< Constructor
+	void operator()(Program& prog);		///< Run the pass over prog
+};
+
+/** Jump threading
+ *
+ * Retargets branches to unconditional jumps to the final destination, and removes jumps to the
+ * following instruction, other than a jump table's. Conditional branches on a constant become
+ * unconditional, or are removed.
+ */
+class JumpThread : public Pass {
+public:
+	JumpThread() : Pass("jumps") {}		///< Constructor
+	void operator()(Program& prog);		///< Run the pass over prog
+};
+
+/** Lambda lifting
+ *
+ * Nested subroutines that make no calls, and only read variables from enclosing blocks, are
+ * passed those variables as additional parameters; each call site pushes the variables values
+ * after the actual parameters. The lifted subroutine then only references its own frame, so
+ * it no longer needs to walk the static links, and may be called as a leaf.
+ *
+ * Only subroutines with no more than maxFree such free variables are lifted.
+ */
+class LambdaLift : public Pass {
+public:
+	static const unsigned maxFree = 4;	///< Maximum number of free variables to lift
+
+	LambdaLift() : Pass("lift") {}		///< Constructor
+	void operator()(Program& prog);		///< Run the pass over prog
+};
+
+/** Scalar promotion
+ *
+ * Variables from enclosing blocks that are referenced within a loop that makes no calls are
+ * cached in a new local variable for the duration of the loop; they're loaded ahead of the
+ * loop, and if written, stored back on each exit from the loop. References within the loop no
+ * longer walk the static links.
+ */
+class ScalarPromote : public Pass {
+public:
+	ScalarPromote() : Pass("promote") {}	///< Constructor
+	void operator()(Program& prog);		///< Run the pass over prog
+};
+
+/** Conversion elimination
+ *
+ * The kinds of constants, and of variables that a loop doesn't write, are known for the duration
+ * of the loop, so their conversions needn't be repeated; constants converted by ITOR2, below
+ * another expression, are converted by the compiler, and the ITOR, ITOR2 and RTOI conversions of
+ * loop invariant variables are hoisted out of loops that make no calls, into a new local variable
+ * that is converted once, ahead of the loop. Constant folding converts the remaining constants.
+ */
+class ConvertElim : public Pass {
+public:
+	ConvertElim() : Pass("convert") {}	///< Constructor
+	void operator()(Program& prog);		///< Run the pass over prog
+};
+
+/** Loop unrolling
+ *
+ * Counted loops, i.e., while i < limit do begin ...; i = i + 1 end, or i <= limit, where the
+ * limit is a constant or a variable the loop doesn't write, and whose body makes no calls, are
+ * unrolled factor times. The unrolled loop runs while i < limit - (factor - 1), and then falls
+ * into the original loop, which runs the remaining iterations.
+ *
+ * Only loops whose body, including the increment, is no more than maxBody instructions are
+ * unrolled; inner loops first. Factors are limited to maxFactor, so that an unrolled loop is at
+ * most maxFactor * maxBody instructions.
+ */
+class LoopUnroll : public Pass {
+public:
+	static const unsigned defaultFactor = 4;	///< Default unroll factor
+	static const unsigned maxFactor = 16;		///< Largest unroll factor
+	static const std::size_t maxBody = 32;		///< Largest loop body to unroll
+
+	/// Constructor; unroll by f, up to maxFactor, where f < 2 disables unrolling
+	LoopUnroll(unsigned f = defaultFactor) : Pass("unroll"), factor{f > maxFactor ? +maxFactor : f} {}
+	void operator()(Program& prog);		///< Run the pass over prog
+
+private:
+	unsigned	factor;					///< The unroll factor
+};
+
+/** Dead store elimination
+ *
+ * Computes the liveness of each subroutine's parameters and locals; stores to slots that won't
+ * be read before they're written again, or the subroutine returns, are removed along with the
+ * expression computing the value, unless it might call, or divide by zero. Locals that are no
+ * longer referenced are then removed from the frame, and the rest renumbered.
+ *
+ * Slots referenced by nested subroutines, and the outer block's variables, which are the
+ * program's results, are left alone.
+ */
+class DeadStore : public Pass {
+public:
+	DeadStore() : Pass("dse") {}		///< Constructor
+	void operator()(Program& prog);		///< Run the pass over prog
+};
+
+/** Frame slot coloring
+ *
+ * Locals whose live ranges don't overlap share a frame slot, shrinking the Enter count. Locals
+ * interfere if one is live where the other is written; locals that nested subroutines reference,
+ * or that may be read before they're written, keep a slot of their own. The outer block's
+ * variables are left alone.
+ */
+class SlotColor : public Pass {
+public:
+	SlotColor() : Pass("color") {}		///< Constructor
+	void operator()(Program& prog);		///< Run the pass over prog
+};
+
+/** Divide by zero check elimination
+ *
+ * Divisions, and remainders, by a nonzero constant, or by a variable whose range excludes zero,
+ * use DivNZ and RemNZ, which don't check the divisor. Ranges of a subroutine's integer
+ * variables are tracked from assignments of constants, increments by constants, and
+ * comparisons with constants, e.g., a loop counter starting at one.
+ */
+class DivCheck : public Pass {
+public:
+	DivCheck() : Pass("divcheck") {}	///< Constructor
+	void operator()(Program& prog);		///< Run the pass over prog
+};
+
+/** Leaf procedure frame elision
+ *
+ * Procedures that make no calls, and only reference their own frame, never need a static link,
+ * or a return value. Such leaf procedures are called via LCall, returning via LRet, which use a
+ * minimal LeafFrame; the offsets of their locals are adjusted to match.
+ */
+class LeafProc : public Pass {
+public:
+	LeafProc() : Pass("leaf") {}		///< Constructor
+	void operator()(Program& prog);		///< Run the pass over prog
+};
+
+#endif
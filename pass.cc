@@ -0,0 +1,304 @@
+/** @file pass.cc
+ *
+ * PL/0C pass manager and program editor implementation
+ *
+ * @author Randy Merkel, Slowly but Surly Software.
+ * @copyright  (c) 2017 Slowly but Surly Software. All rights reserved.
+ */
+
+#include "pass.h"
+#include "opt.h"
+
+#include <cassert>
+#include <chrono>
+#include <iomanip>
+
+using namespace std;
+
+/**
+ * @param	op	The operation code to test
+ * @return	true if op's address is an instruction address.
+ */
+bool isBranch(OpCode op) {
+	switch (op) {
+	case OpCode::Call:
+	case OpCode::LCall:
+	case OpCode::Jump:
+	case OpCode::JNEQ:
+	case OpCode::ForTest:
+	case OpCode::ForNext:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/************************************************************************************************
+ *	class Editor
+ ************************************************************************************************/
+
+// public static
+
+const Editor::Node Editor::none = static_cast<Editor::Node>(-1);
+
+// public
+
+/**
+ * Builds a node for each instruction, in order, resolving branch targets and subroutine entry and
+ * exit points.
+ * @param	p	The program to edit
+ */
+Editor::Editor(Program& p) : prog{p}, head{none}, tail{none} {
+	const auto n = prog.code.size();
+
+	instrs = prog.code;
+	lines = prog.index;
+	lines.resize(n, lines.empty() ? 0 : lines.back());
+	targets.assign(n, none);
+	refs.assign(n, 0);
+	dead.assign(n, false);
+	for (Node i = 0; i < n; ++i) {
+		nexts.push_back(i + 1 < n ? i + 1 : none);
+		prevs.push_back(i > 0 ? i - 1 : none);
+	}
+
+	if (n > 0) {
+		head = 0;
+		tail = n - 1;
+	}
+
+	for (Node i = 0; i < n; ++i)
+		if (isBranch(instrs[i].op) && instrs[i].addr.uinteger() < n)
+			target(i, instrs[i].addr.uinteger());
+
+	for (const auto& s : prog.subrs) {
+		entries.push_back(s.entry);
+		exits.push_back(s.exit);
+		++refs[s.entry];
+	}
+}
+
+/**
+ * @param	n	The branch instruction
+ * @param	t	It's new target, or none
+ */
+void Editor::target(Node n, Node t) {
+	if (none != targets[n]) --refs[targets[n]];
+	targets[n] = t;
+	if (none != t) ++refs[t];
+}
+
+/**
+ * @param	n		Insert ahead of this node
+ * @param	instr	The instruction to insert
+ * @param	t		The new instructions branch target, if any
+ * @return	The new node
+ */
+Editor::Node Editor::insert(Node n, const Instr& instr, Node t) {
+	const Node node = instrs.size();
+
+	instrs.push_back(instr);
+	lines.push_back(lines[n]);
+	targets.push_back(none);
+	refs.push_back(0);
+	dead.push_back(false);
+	nexts.push_back(n);
+	prevs.push_back(prevs[n]);
+
+	if (none == prevs[n])
+		head = node;
+	else
+		nexts[prevs[n]] = node;
+	prevs[n] = node;
+
+	target(node, t);
+	return node;
+}
+
+/**
+ * Unlinks n from the layout. References to n, if any, are redirected to the node that followed
+ * it, so that branch targets always refer to live nodes.
+ * @param	n	The node to erase
+ */
+void Editor::erase(Node n) {
+	assert(!dead[n]);
+
+	if (refs[n] > 0) {
+		assert(none != nexts[n]);
+		redirect(n, nexts[n]);
+	}
+	target(n, none);
+
+	if (none == prevs[n])	head = nexts[n];
+	else					nexts[prevs[n]] = nexts[n];
+
+	if (none == nexts[n])	tail = prevs[n];
+	else					prevs[nexts[n]] = prevs[n];
+
+	dead[n] = true;
+}
+
+/**
+ * @param	from	Branches to, and subroutine entry points at from...
+ * @param	to		are redirected to to
+ */
+void Editor::redirect(Node from, Node to) {
+	if (from == to) return;
+
+	for (Node i = 0; i < targets.size(); ++i)
+		if (targets[i] == from && !dead[i])
+			target(i, to);
+
+	for (auto& e : entries)
+		if (e == from) {
+			--refs[from];
+			++refs[to];
+			e = to;
+		}
+}
+
+/**
+ * Calls to the subroutine's current entry node are retargeted to n, but other branches to the
+ * old entry point, e.g., from a loop at the start of the body, are not.
+ * @param	s	The subroutine
+ * @param	n	Its new entry point
+ */
+void Editor::entry(size_t s, Node n) {
+	const auto old = entries[s];
+
+	for (Node i = 0; i < targets.size(); ++i)
+		if (targets[i] == old && !dead[i] && (OpCode::Call == instrs[i].op || OpCode::LCall == instrs[i].op))
+			target(i, n);
+
+	--refs[old];
+	++refs[n];
+	entries[s] = n;
+}
+
+/**
+ * @param	subr	The subroutine, whose entry and exit are ignored
+ * @param	entry	The subroutine entry point
+ * @param	exit	The subroutines Ret or Retf
+ * @return	The index of the new subroutine in Program::subrs
+ */
+size_t Editor::subroutine(const Subroutine& subr, Node entry, Node exit) {
+	prog.subrs.push_back(subr);
+	entries.push_back(entry);
+	exits.push_back(exit);
+	++refs[entry];
+	return prog.subrs.size() - 1;
+}
+
+/**
+ * Lays out the live nodes in order, assigns addresses, and then resolves branch targets,
+ * subroutine entry and exit points, and the source cross index.
+ */
+void Editor::commit() {
+	vector<Datum::Unsigned>	addr(instrs.size(), 0);
+
+	Datum::Unsigned loc = 0;
+	for (Node n = head; n != none; n = nexts[n])
+		addr[n] = loc++;
+
+	prog.code.clear();
+	prog.index.clear();
+	for (Node n = head; n != none; n = nexts[n]) {
+		Instr instr = instrs[n];
+		if (isBranch(instr.op) && none != targets[n])
+			instr.addr = addr[targets[n]];
+
+		prog.code.push_back(instr);
+		prog.index.push_back(lines[n]);
+	}
+
+	for (size_t s = 0; s < prog.subrs.size(); ++s) {
+		prog.subrs[s].entry = addr[entries[s]];
+		prog.subrs[s].exit = addr[exits[s]];
+	}
+}
+
+/************************************************************************************************
+ *	class PassManager
+ ************************************************************************************************/
+
+// public
+
+/**
+ * @param	l		The optimization level; 0, 1 or 2.
+ * @param	unroll	The loop unrolling factor, at level 2
+ */
+PassManager::PassManager(unsigned l, unsigned unroll) : lvl{l} {
+	if (lvl >= 2)
+		add(new ConstProp);						// Ahead of folding the constants it exposes
+
+	if (lvl >= 1)
+		add(new ConstFold);
+
+	if (lvl >= 2) {
+		add(new PartialEval);
+		add(new ConstFold);						// Fold the results
+	}
+
+	if (lvl >= 1)
+		add(new JumpThread);
+
+	if (lvl >= 2) {
+		add(new LambdaLift);
+		add(new ScalarPromote);
+		add(new ConvertElim);
+		add(new LoopUnroll(unroll));
+		add(new DeadStore);
+		add(new SlotColor);
+		add(new DivCheck);
+	}
+
+	if (lvl >= 1)
+		add(new LeafProc);						// Must follow passes that reference frames
+}
+
+/// @param	pass	The pass to append to the pipeline
+void PassManager::add(Pass* pass) {
+	passes.push_back(unique_ptr<Pass>(pass));
+}
+
+/**
+ * @param	name	The name to record f's statistics under
+ * @param	code	The code f works on
+ * @param	f		The work to time
+ */
+void PassManager::time(const string& name, const InstrVector& code, function<void()> f) {
+	const auto before = code.size();
+	const auto start = chrono::steady_clock::now();
+
+	f();
+
+	const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	stats.push_back({ name, elapsed.count(), before, code.size() });
+}
+
+/// @param	prog	The program to optimize
+void PassManager::operator()(Program& prog) {
+	for (auto& pass : passes)
+		time(pass->name(), prog.code, [&] { (*pass)(prog); });
+}
+
+/// @param	out	Where to write the report
+void PassManager::report(ostream& out) const {
+	double total = 0;
+
+	out << "Pass            Time (ms)   Before    After\n"
+		<< "-------------------------------------------\n";
+
+	for (const auto& s : stats) {
+		out << left << setw(15) << s.name << right
+			<< fixed << setprecision(3) << setw(10) << s.seconds * 1000
+			<< setw(9) << s.before
+			<< setw(9) << s.after << "\n";
+		total += s.seconds;
+	}
+
+	out << "-------------------------------------------\n"
+		<< left << setw(15) << "total" << right
+		<< fixed << setprecision(3) << setw(10) << total * 1000 << "\n";
+}
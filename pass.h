@@ -0,0 +1,177 @@
+/** @file pass.h
+ *
+ * The PL/0C pass manager, and the program representation shared by the compiler (Comp) and the
+ * optimization passes.
+ *
+ * @author Randy Merkel, Slowly but Surly Software.
+ * @copyright  (c) 2017 Slowly but Surly Software. All rights reserved.
+ */
+
+#ifndef	PASS_H
+#define	PASS_H
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "instr.h"
+
+/// A table, indexed by instruction address, yielding source line numbers
+typedef std::vector<unsigned> SourceIndex;
+
+/** A compiled subroutine
+ *
+ * Comp records the entry point, extent and nesting of every block it compiles, so that passes
+ * may work on whole subroutines without having to rediscover them from the code. The body of a
+ * subroutine is the contiguous range entry..exit; nested subroutines are emitted ahead of it.
+ */
+struct Subroutine {
+	std::string		name;				///< Subroutine name, "main" for the outer block
+	Datum::Unsigned	entry;				///< Entry point; Enter, or the first statement
+	Datum::Unsigned	exit;				///< Address of the closing Ret or Retf
+	int				level;				///< Block level of the body
+	int				parent;				///< Index of the enclosing subroutine, -1 for main
+	unsigned		nParams;			///< Number of formal parameters
+	bool			function;			///< True if a function, false if a procedure
+};
+
+/// A vector of Subroutines
+typedef std::vector<Subroutine>	SubrVector;
+
+/// A program, as seen by the passes; its code, the code's source cross index and subroutines
+struct Program {
+	InstrVector&	code;				///< The code
+	SourceIndex&	index;				///< Source line of each instruction in code
+	SubrVector&		subrs;				///< The programs subroutines; main is subrs[0]
+};
+
+/// Is op a branch, i.e., does its address refer to an instruction?
+bool isBranch(OpCode op);
+
+/** An editable Program
+ *
+ * Instructions are held as nodes in a linked list. Branch targets, subroutine entry and exit
+ * points refer to nodes rather than addresses, so passes may insert and delete instructions
+ * freely; commit() lays the code back out, resolving addresses and the source cross index.
+ *
+ * Nodes are numbered by their original address; inserted nodes are numbered from the end of the
+ * original code.
+ */
+class Editor {
+public:
+	typedef std::size_t	Node;			///< An instruction handle
+
+	static const Node	none;			///< No such node
+
+	Editor(Program& prog);				///< Edit prog...
+
+	Node begin() const					{	return head;		}	///< Return the first node
+	Node end() const					{	return tail;		}	///< Return the last node
+	Node next(Node n) const				{	return nexts[n];	}	///< Return the node after n
+	Node prev(Node n) const				{	return prevs[n];	}	///< Return the node before n
+	std::size_t size() const			{	return instrs.size();	}	///< Number of nodes
+
+	/// Return the instruction at n
+	Instr& operator[](Node n)			{	return instrs[n];	}
+
+	/// Return the branch target of n
+	Node target(Node n) const			{	return targets[n];	}
+	void target(Node n, Node t);		///< Set the branch target of n
+
+	/// Is n the target of a branch, or a subroutine entry point?
+	bool targeted(Node n) const			{	return refs[n] > 0;	}
+
+	/// Has n been erased?
+	bool erased(Node n) const			{	return dead[n];		}
+
+	/// Insert an instruction ahead of n, which it shares its source line with...
+	Node insert(Node n, const Instr& instr, Node target = none);
+	void erase(Node n);					///< Erase n, redirecting references to the next node
+	void redirect(Node from, Node to);	///< Redirect references to from, to to
+
+	Node entry(std::size_t s) const		{	return entries[s];	}	///< Subroutine entry node
+	void entry(std::size_t s, Node n);	///< Set a subroutines entry node, and retarget its calls
+	Node exit(std::size_t s) const		{	return exits[s];	}	///< Subroutine exit node
+
+	/// Append a subroutine, returning its index
+	std::size_t subroutine(const Subroutine& subr, Node entry, Node exit);
+
+	void commit();						///< Write the edits back to the Program
+
+private:
+	Program&			prog;			///< The program being edited
+	InstrVector			instrs;			///< Instructions, indexed by node
+	SourceIndex			lines;			///< Source lines, indexed by node
+	std::vector<Node>	targets;		///< Branch targets, indexed by node
+	std::vector<Node>	nexts;			///< Next node in the layout
+	std::vector<Node>	prevs;			///< Previous node in the layout
+	std::vector<unsigned> refs;			///< Number of references to each node
+	std::vector<bool>	dead;			///< Erased nodes
+	std::vector<Node>	entries;		///< Subroutine entry nodes
+	std::vector<Node>	exits;			///< Subroutine exit nodes
+	Node				head;			///< First node in the layout
+	Node				tail;			///< Last node in the layout
+};
+
+/** An optimization pass
+ *
+ * Passes transform a Program in place. Passes are run, in order, by the PassManager.
+ */
+class Pass {
+public:
+	/// Construct a pass called name
+	Pass(const std::string& name) : _name{name} {}
+	virtual ~Pass() {}					///< Destructor
+
+	/// Return the pass name, as reported by -time-passes
+	const std::string& name() const		{	return _name;	}
+
+	/// Run the pass over prog
+	virtual void operator()(Program& prog) = 0;
+
+private:
+	std::string		_name;				///< The passes name
+};
+
+/** The PL/0C Pass Manager
+ *
+ * Sequences the compiler and the bytecode optimization passes for an optimization level, and
+ * records each passes wall time and instruction counts:
+ * - 0: No optimization; the code is just as Comp emitted it.
+ * - 1: Cheap local optimizations; constant folding, jump threading and leaf procedures.
+ * - 2: Level 1, plus whole subroutine and interprocedural optimizations.
+ */
+class PassManager {
+public:
+	/// Construct the pass pipeline for optimization level lvl
+	PassManager(unsigned lvl = 0, unsigned unroll = 4);
+	virtual ~PassManager() {}			///< Destructor
+
+	unsigned level() const				{	return lvl;		}	///< The optimization level
+
+	void add(Pass* pass);				///< Append pass, which this takes ownership of
+
+	/// Run f, recording its time and effect on code, as name
+	void time(const std::string& name, const InstrVector& code, std::function<void()> f);
+
+	void operator()(Program& prog);		///< Run the passes over prog
+
+	void report(std::ostream& out) const;	///< Write a -time-passes report on out
+
+private:
+	/// The time taken by, and the effect of, a single pass
+	struct Stat {
+		std::string	name;				///< Pass name
+		double		seconds;			///< Wall time
+		std::size_t	before;				///< Number of instructions before the pass
+		std::size_t	after;				///< Number of instructions after the pass
+	};
+
+	unsigned							lvl;	///< Optimization level
+	std::vector<std::unique_ptr<Pass>>	passes;	///< The pipeline
+	std::vector<Stat>					stats;	///< Pass statistics, in order run
+};
+
+#endif
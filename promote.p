@@ -0,0 +1,20 @@
+{ Variables from enclosing blocks that are referenced in	}
+{ loops are cached in local variables at -O2				}
+var sum, count : integer;
+
+procedure tally(n : integer)
+	var i : integer;
+	begin
+		i = 0;
+		repeat begin
+			sum = sum + i;
+			if sum > 10 then count = count + 1;
+			i = i + 1
+		end until i >= n
+	end;
+
+begin
+	sum = 0;
+	count = 0;
+	tally(6)
+end.
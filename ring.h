@@ -0,0 +1,66 @@
+/**	@file	ring.h
+ *
+ * A single producer, single consumer, lock-free ring buffer
+ *
+ * @author Randy Merkel, Slowly but Surly Software.
+ * @copyright  (c) 2017 Slowly but Surly Software. All rights reserved.
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <atomic>
+#include <cstddef>
+
+/** A single producer, single consumer, lock-free ring buffer
+ *
+ * One thread may push(), while another pop()s; neither blocks, but returns false if the ring is
+ * full, or empty, respectively. The head and tail counters are on separate cache lines, so the
+ * producer and consumer don't contend for them. N must be a power of two.
+ */
+template <typename T, std::size_t N>
+class Ring {
+public:
+	static_assert(N > 0 && 0 == (N & (N - 1)), "Ring size must be a power of two");
+
+	/**
+	 * @param	value	The value to append, if there's room
+	 * @return	false if the ring is full
+	 */
+	bool push(const T& value) {
+		const auto h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == N)
+			return false;
+
+		slots[h & (N - 1)] = value;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @param[out]	value	The oldest value, if any
+	 * @return	false if the ring is empty
+	 */
+	bool pop(T& value) {
+		const auto t = tail.load(std::memory_order_relaxed);
+		if (head.load(std::memory_order_acquire) == t)
+			return false;
+
+		value = slots[t & (N - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Empty the ring; neither thread may be using it
+	void clear() {
+		head.store(0);
+		tail.store(0);
+	}
+
+private:
+	T									slots[N];		///< The values
+	alignas(64) std::atomic<std::size_t> head {0};		///< Count of values pushed
+	alignas(64) std::atomic<std::size_t> tail {0};		///< Count of values popped
+};
+
+#endif
@@ -0,0 +1,228 @@
+/**	@file	scan.cc
+ *
+ * The PL/0C scanner's fast paths implementation
+ *
+ * @author Randy Merkel, Slowly but Surly Software.
+ * @copyright  (c) 2017 Slowly but Surly Software. All rights reserved.
+ */
+
+#include "scan.h"
+
+#include <cctype>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(NO_SIMD)
+#define	SCAN_X86								///< Build the SSE2 and AVX2 fast paths
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+/************************************************************************************************
+ *	Scalar
+ ************************************************************************************************/
+
+static const char* scalarSpace(const char* p, const char* lim, size_t& lines) {
+	for (; p < lim && isspace(static_cast<unsigned char>(*p)); ++p)
+		if ('\n' == *p) ++lines;
+
+	return p;
+}
+
+static const char* scalarComment(const char* p, const char* lim, size_t& lines) {
+	for (; p < lim && '}' != *p; ++p)
+		if ('\n' == *p) ++lines;
+
+	return p;
+}
+
+static const char* scalarIdent(const char* p, const char* lim) {
+	while (p < lim && isalnum(static_cast<unsigned char>(*p)))
+		++p;
+
+	return p;
+}
+
+static const char* scalarDigits(const char* p, const char* lim) {
+	while (p < lim && isdigit(static_cast<unsigned char>(*p)))
+		++p;
+
+	return p;
+}
+
+#ifdef	SCAN_X86
+
+/************************************************************************************************
+ *	SSE2; 16 characters at a time. Each leaves the last, partial, block to the scalar version.
+ ************************************************************************************************/
+
+/// @return	lanes of v where lo <= v <= lo + n
+__attribute__((target("sse2")))
+static inline __m128i sse2Range(__m128i v, char lo, char n) {
+	const __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+	return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(n)), d);
+}
+
+/// @return	lanes of v that are alphanumeric
+__attribute__((target("sse2")))
+static inline __m128i sse2Alnum(__m128i v) {
+	return _mm_or_si128(sse2Range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z' - 'a'), sse2Range(v, '0', 9));
+}
+
+__attribute__((target("sse2")))
+static const char* sse2Space(const char* p, const char* lim, size_t& lines) {
+	for (; lim - p >= 16; p += 16) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const unsigned nl = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+		const __m128i ws = _mm_or_si128(sse2Range(v, '\t', '\r' - '\t'), _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+		const unsigned stop = ~_mm_movemask_epi8(ws) & 0xffff;
+		if (stop) {
+			const unsigned n = __builtin_ctz(stop);
+			lines += __builtin_popcount(nl & ((1u << n) - 1));
+			return p + n;
+		}
+		lines += __builtin_popcount(nl);
+	}
+
+	return scalarSpace(p, lim, lines);
+}
+
+__attribute__((target("sse2")))
+static const char* sse2Comment(const char* p, const char* lim, size_t& lines) {
+	for (; lim - p >= 16; p += 16) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const unsigned nl = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+		const unsigned stop = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('}')));
+		if (stop) {
+			const unsigned n = __builtin_ctz(stop);
+			lines += __builtin_popcount(nl & ((1u << n) - 1));
+			return p + n;
+		}
+		lines += __builtin_popcount(nl);
+	}
+
+	return scalarComment(p, lim, lines);
+}
+
+__attribute__((target("sse2")))
+static const char* sse2Ident(const char* p, const char* lim) {
+	for (; lim - p >= 16; p += 16) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const unsigned stop = ~_mm_movemask_epi8(sse2Alnum(v)) & 0xffff;
+		if (stop)
+			return p + __builtin_ctz(stop);
+	}
+
+	return scalarIdent(p, lim);
+}
+
+__attribute__((target("sse2")))
+static const char* sse2Digits(const char* p, const char* lim) {
+	for (; lim - p >= 16; p += 16) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const unsigned stop = ~_mm_movemask_epi8(sse2Range(v, '0', 9)) & 0xffff;
+		if (stop)
+			return p + __builtin_ctz(stop);
+	}
+
+	return scalarDigits(p, lim);
+}
+
+/************************************************************************************************
+ *	AVX2; 32 characters at a time, then SSE2
+ ************************************************************************************************/
+
+/// @return	lanes of v where lo <= v <= lo + n
+__attribute__((target("avx2")))
+static inline __m256i avx2Range(__m256i v, char lo, char n) {
+	const __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+	return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(n)), d);
+}
+
+/// @return	lanes of v that are alphanumeric
+__attribute__((target("avx2")))
+static inline __m256i avx2Alnum(__m256i v) {
+	return _mm256_or_si256(avx2Range(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z' - 'a'), avx2Range(v, '0', 9));
+}
+
+__attribute__((target("avx2")))
+static const char* avx2Space(const char* p, const char* lim, size_t& lines) {
+	for (; lim - p >= 32; p += 32) {
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		const unsigned nl = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+		const __m256i ws = _mm256_or_si256(avx2Range(v, '\t', '\r' - '\t'), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+		const unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(ws));
+		if (stop) {
+			const unsigned n = __builtin_ctz(stop);
+			lines += __builtin_popcount(nl & ((1u << n) - 1));
+			return p + n;
+		}
+		lines += __builtin_popcount(nl);
+	}
+
+	return sse2Space(p, lim, lines);
+}
+
+__attribute__((target("avx2")))
+static const char* avx2Comment(const char* p, const char* lim, size_t& lines) {
+	for (; lim - p >= 32; p += 32) {
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		const unsigned nl = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+		const unsigned stop = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('}')));
+		if (stop) {
+			const unsigned n = __builtin_ctz(stop);
+			lines += __builtin_popcount(nl & ((1u << n) - 1));
+			return p + n;
+		}
+		lines += __builtin_popcount(nl);
+	}
+
+	return sse2Comment(p, lim, lines);
+}
+
+__attribute__((target("avx2")))
+static const char* avx2Ident(const char* p, const char* lim) {
+	for (; lim - p >= 32; p += 32) {
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		const unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(avx2Alnum(v)));
+		if (stop)
+			return p + __builtin_ctz(stop);
+	}
+
+	return sse2Ident(p, lim);
+}
+
+__attribute__((target("avx2")))
+static const char* avx2Digits(const char* p, const char* lim) {
+	for (; lim - p >= 32; p += 32) {
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		const unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(avx2Range(v, '0', 9)));
+		if (stop)
+			return p + __builtin_ctz(stop);
+	}
+
+	return sse2Digits(p, lim);
+}
+
+#endif
+
+/************************************************************************************************
+ *	class Scan
+ ************************************************************************************************/
+
+// private static
+
+Scan::Ops Scan::ops = Scan::select();
+
+/// @return the fast paths for the best instruction set the processor supports
+Scan::Ops Scan::select() {
+#ifdef	SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return { avx2Space, avx2Comment, avx2Ident, avx2Digits };
+
+	if (__builtin_cpu_supports("sse2"))
+		return { sse2Space, sse2Comment, sse2Ident, sse2Digits };
+#endif
+
+	return { scalarSpace, scalarComment, scalarIdent, scalarDigits };
+}
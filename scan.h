@@ -0,0 +1,60 @@
+/**	@file	scan.h
+ *
+ * The PL/0C scanner's fast paths
+ *
+ * @author Randy Merkel, Slowly but Surly Software.
+ * @copyright  (c) 2017 Slowly but Surly Software. All rights reserved.
+ */
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+
+/** Scanner fast paths
+ *
+ * Skips runs of whitespace, comment text, identifier characters and digits, in [p, lim),
+ * returning a pointer to the first character that isn't part of the run, or lim. Whitespace and
+ * comments add the newlines they skip to lines.
+ *
+ * The runs are scanned 32 characters at a time with AVX2, or 16 at a time with SSE2, if the
+ * processor supports them, and one at a time otherwise; the instruction set is detected once,
+ * at start up. Defining NO_SIMD selects the scalar versions.
+ */
+class Scan {
+public:
+	/// Skip whitespace
+	static const char* space(const char* p, const char* lim, std::size_t& lines) {
+		return ops.space(p, lim, lines);
+	}
+
+	/// Skip comment text, up to the closing '}'
+	static const char* comment(const char* p, const char* lim, std::size_t& lines) {
+		return ops.comment(p, lim, lines);
+	}
+
+	/// Skip letters and digits
+	static const char* ident(const char* p, const char* lim) {
+		return ops.ident(p, lim);
+	}
+
+	/// Skip digits
+	static const char* digits(const char* p, const char* lim) {
+		return ops.digits(p, lim);
+	}
+
+private:
+	/// The fast paths for an instruction set
+	struct Ops {
+		const char* (*space)(const char*, const char*, std::size_t&);	///< Skip whitespace
+		const char* (*comment)(const char*, const char*, std::size_t&);	///< Skip comment text
+		const char* (*ident)(const char*, const char*);				///< Skip letters and digits
+		const char* (*digits)(const char*, const char*);				///< Skip digits
+	};
+
+	static Ops		ops;						///< The selected fast paths
+
+	static Ops select();						///< The best supported fast paths
+};
+
+#endif
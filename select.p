@@ -0,0 +1,23 @@
+{ If statements that just assign one of two values to a variable	}
+{ select the value, rather than branching							}
+var big, odd : integer;
+
+procedure classify(n : integer)
+	var i, v, b, o : integer;
+	begin
+		b = 0;
+		o = 0;
+		i = 0;
+		while i < n do begin
+			v = (i * 7) % 10;
+			if v > 4 then b = b + 1 else b = b;
+			if v % 2 == 1 then o = o + 1 else o = o - 0;
+			i = i + 1
+		end;
+		big = b;
+		if b > o then odd = 0 else odd = 1
+	end;
+
+begin
+	classify(10)
+end.
@@ -0,0 +1,36 @@
+{ && and || stop at the first operand that decides the result, so	}
+{ calls counts the calls to test that are actually made; real		}
+{ operands are true if they're not 0.0								}
+var calls, i, x, y : integer; r : real;
+
+function test(v : integer) : integer
+	begin
+		calls = calls + 1;
+		test = v
+	end;
+
+begin
+	calls = 0;
+	x = 0 && test(1);					{ s/b 0, no call			}
+	y = 1 || test(0);					{ s/b 1, no call			}
+	x = (1 && test(2)) || test(3);		{ s/b 1, one call			}
+	i = 0;
+	while (i < 5) && (test(i) != 3) do
+		i = i + 1;						{ s/b 3						}
+	if (i == 0) || (i == 3) then
+		y = 2
+	else
+		y = 3;							{ s/b 2						}
+	repeat
+		i = i - 1
+	until (i < 1) || test(0) && test(1);	{ s/b 0					}
+	x = !((i == 0) && (y == 2));		{ s/b 0						}
+	r = 0.5;
+	x = r && 1;							{ s/b 1						}
+	y = 0.0 || test(0);					{ s/b 0, one call			}
+	if r && (i == 0) then
+		y = 4
+	else
+		y = 5;							{ s/b 4						}
+	x = test(1) && (r - 0.5)			{ s/b 0, one call			}
+end.
@@ -102,3 +102,128 @@ Datum::KindVec& SymValue::params() 					{   return p;			}
  */
 const Datum::KindVec& SymValue::params() const 		{   return p;			}
 
+
+/************************************************************************************************
+ *	class SymbolTable
+ ************************************************************************************************/
+
+// public
+
+SymbolTable::SymbolTable() : slots(64), nUsed{0} {}
+
+/**
+ * Entries may shadow declarations from enclosing scopes; it's up to the caller to check for
+ * duplicate declarations in the same scope.
+ *
+ * @param	entry	The identifier and it's value
+ * @return	The new entry
+ */
+SymbolTable::iterator SymbolTable::insert(value_type entry) {
+	Slot& s = slot(entry.first);
+	log.push_back({ std::move(entry), s.top });
+	s.top = &log.back();
+	return &s.top->value;
+}
+
+/**
+ * @param	id	The identifier to look up
+ * @return	id's closest declaration, or end() if it isn't declared
+ */
+SymbolTable::iterator SymbolTable::find(Interner::Id id) {
+	const Slot* s = lookup(id);
+	return s && s->top ? &s->top->value : end();
+}
+
+/**
+ * @param	id		The identifier to look up
+ * @param	level	The block level
+ * @return	id's declaration at level, or end() if it isn't declared at level
+ */
+SymbolTable::iterator SymbolTable::find(Interner::Id id, int level) {
+	const Slot* s = lookup(id);
+	for (Entry* e = s ? s->top : nullptr; e && e->value.second.level() >= level; e = e->shadow)
+		if (e->value.second.level() == level)
+			return &e->value;
+
+	return end();
+}
+
+void SymbolTable::enter() {
+	marks.push_back(log.size());
+}
+
+/// @param	purged	If not null, called with each of the scope's entries, latest first
+void SymbolTable::leave(Purged purged) {
+	assert(!marks.empty());
+
+	for (const auto mark = marks.back(); log.size() > mark; log.pop_back()) {
+		Entry& e = log.back();
+		if (purged) purged(e.value);
+		lookup(e.value.first)->top = e.shadow;
+	}
+	marks.pop_back();
+}
+
+// private static
+
+/**
+ * Fibonacci hashing; ids are assigned in order, so spread them across the table.
+ * @param	id	The identifier
+ * @return	id's hash
+ */
+size_t SymbolTable::hash(Interner::Id id) {
+	return (id * 2654435769u) >> 8;
+}
+
+// private
+
+/**
+ * @param	id	The identifier
+ * @return	id's slot, or nullptr if id hasn't been seen before
+ */
+SymbolTable::Slot* SymbolTable::lookup(Interner::Id id) {
+	const auto mask = slots.size() - 1;
+
+	for (auto i = hash(id) & mask; slots[i].used; i = (i + 1) & mask)
+		if (slots[i].id == id)
+			return &slots[i];
+
+	return nullptr;
+}
+
+/**
+ * @param	id	The identifier
+ * @return	id's slot, which is added, without a declaration, if id hasn't been seen before
+ */
+SymbolTable::Slot& SymbolTable::slot(Interner::Id id) {
+	if (Slot* s = lookup(id))
+		return *s;
+
+	if (4 * (nUsed + 1) > 3 * slots.size()) {	// Keep the load factor under 3/4
+		grow();
+		return slot(id);
+	}
+
+	const auto mask = slots.size() - 1;
+	auto i = hash(id) & mask;
+	while (slots[i].used)
+		i = (i + 1) & mask;
+
+	++nUsed;
+	slots[i] = { id, nullptr, true };
+	return slots[i];
+}
+
+void SymbolTable::grow() {
+	vector<Slot> old(slots.size() * 2);
+	old.swap(slots);
+
+	const auto mask = slots.size() - 1;
+	for (auto& s : old)
+		if (s.used) {
+			auto i = hash(s.id) & mask;
+			while (slots[i].used)
+				i = (i + 1) & mask;
+			slots[i] = s;
+		}
+}
@@ -10,10 +10,15 @@
 #define SYMBOL_H
 
 #include <cstdint>
-#include <map>
+#include <deque>
+#include <functional>
 #include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "datum.h"
+#include "intern.h"
 
 /** A Symbol table entry
  *
@@ -66,7 +71,55 @@ private:
 	Datum::KindVec	p;							///< Subrouuntine parameter kinds
 };
 
-/// A SymbolTable; a multimap of symbol identifiers to SymValue's
-typedef std::multimap<std::string, SymValue> SymbolTable;
+/** A scoped symbol table
+ *
+ * An open addressing hash table, with linear probing, of interned identifiers to their closest, i.e.,
+ * innermost, declaration, which in turn refers to the declaration it shadows, if any. Entries
+ * are kept in a log, in order of declaration; entering a scope marks the log, leaving it undoes
+ * the scope's entries, restoring the declarations they shadowed. Entries are never moved, so
+ * references to them remain valid until their scope is left.
+ */
+class SymbolTable {
+public:
+	typedef std::pair<const Interner::Id, SymValue> value_type;	///< An identifier and it's value
+	typedef value_type* iterator;				///< Refers to an entry, or end()
+
+	/// Called with each entry as it's scope is left
+	typedef std::function<void(const value_type&)> Purged;
+
+	SymbolTable();								///< Constructor
+
+	iterator insert(value_type entry);			///< Declare an identifier in the current scope
+	iterator find(Interner::Id id);				///< Find id's closest declaration
+	iterator find(Interner::Id id, int level);	///< Find id's declaration at level
+	iterator end()								{	return nullptr;		}	///< Not found
+
+	void enter();								///< Enter a new scope
+	void leave(Purged purged = nullptr);		///< Leave the current scope
+
+private:
+	/// A declaration, and the one it shadows, if any
+	struct Entry {
+		value_type	value;						///< The identifier and it's value
+		Entry*		shadow;						///< The shadowed declaration, or nullptr
+	};
+
+	/// A hash table slot; an identifier and it's closest declaration, if any
+	struct Slot {
+		Interner::Id id;						///< The identifier
+		Entry*		top;						///< id's closest declaration, or nullptr
+		bool		used;						///< Is the slot in use?
+	};
+
+	std::vector<Slot>		slots;				///< The hash table, a power of two slots
+	std::size_t				nUsed;				///< Number of slots in use
+	std::deque<Entry>		log;				///< Entries in order of declaration
+	std::vector<std::size_t> marks;				///< Log size at the start of each scope
+
+	static std::size_t hash(Interner::Id id);	///< id's hash
+	Slot* lookup(Interner::Id id);				///< Find id's slot
+	Slot& slot(Interner::Id id);				///< Find, or add, id's slot
+	void grow();								///< Double the number of slots
+};
 
 #endif
@@ -9,10 +9,20 @@
  */
 
 #include "token.h"
+#include "scan.h"
 
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <limits>
 #include <iostream>
 #include <sstream>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using namespace std;
 
 /************************************************************************************************
@@ -21,158 +31,266 @@ using namespace std;
 
 // private:
 
-std::istream& TokenStream::getch(char& c) {
-	if (col == line.size()) {
-		col = 0;
-		line.clear();
-		if (getline(*ip, line))
-			line.push_back('\n');
+/**
+ * @param[out]	c	The next character
+ * @return	false at the end of the input
+ */
+bool TokenStream::getch(char& c) {
+	if (cur == lim && !refill()) {
+		prev = nullptr;							// Nothing to return at the end of input
+		return false;
 	}
 
-	if (col < line.size())
-		c = line[col++];
+	prev = cur;
+	c = *cur++;
+	return true;
+}
 
-	return *ip;
+void TokenStream::unget() {
+	if (prev) {
+		cur = prev;
+		prev = nullptr;
+	}
 }
 
-std::istream& TokenStream::unget() {
-	if (col > 0) --col;
-	return *ip;
+/// @return false if there isn't an input stream, or it's at the end of file
+bool TokenStream::refill() {
+	if (!ip || !getline(*ip, line))
+		return false;
+
+	line.push_back('\n');
+	if (keeping)
+		contents += line;
+
+	cur = line.data();
+	lim = cur + line.size();
+	return true;
 }
 
-/// Read and return the next token
-Token TokenStream::get() {
+/// Stop the scanning thread, if any. If *this* owns ip, delete it, and release the mapping, if any.
+void TokenStream::close() {
+	if (scanner.joinable()) {
+		stopping = true;
+		scanner.join();
+	}
+	stopping = done = false;
+	ring.clear();
+
+	if (owns) delete ip;
+	if (mapping) munmap(mapping, mapSize);
+
+	ip = nullptr;
+	owns = false;
+	mapping = nullptr;
+	text = {};
+	contents.clear();
+	cur = lim = prev = nullptr;
+
+	tok = { Token::EOS };						// Errors before the first token are on line 1
+	tok.line = lineNum = 1;
+}
+
+/// Scan the next token into ct; identifiers are left for the consumer to intern
+Token& TokenStream::scan() {
 	char ch = 0;
 
-	do {										// skip whitespace...
-		if (!getch(ch))
-			return ct = { Token::EOS };
+	for (;;) {									// skip whitespace, counting lines...
+		cur = Scan::space(cur, lim, lineNum);
+		if (cur < lim)
+			break;
 
-		if ('\n' == ch) ++lineNum;				// Count lines
+		if (!refill()) {
+			prev = nullptr;
+			return ct = { Token::EOS };
+		}
+	}
 
-	} while (isspace(ch));
+	getch(ch);
+	const char* start = prev;					// The token's first character
 
 	switch (ch) {
 	case '=':									// = or ==?
 		if (!getch(ch))		ct.kind = Token::Assign;
 		else if ('=' == ch) ct.kind = Token::EQU;
 		else {	unget();	ct.kind = Token::Assign;	}
-		return ct;
+		break;
 
 	case '!':									// ! or !=?
 		if (!getch(ch))		ct.kind = Token::NOT;
 		else if ('=' == ch) ct.kind = Token::NEQU;
 		else {	unget();	ct.kind = Token::NOT;	}
-		return ct;
+		break;
 
 	case '>':									// >, >> or >=?
 		if (!getch(ch))		ct.kind = Token::GT;
 		else if ('>' == ch)	ct.kind = Token::ShiftR;
 		else if ('=' == ch)	ct.kind = Token::GTE;
 		else {	unget();	ct.kind = Token::GT;	}
-		return ct;
+		break;
 
 	case '<':									// <, << or <=?
 		if (!getch(ch))		ct.kind = Token::LT;
 		else if ('<' == ch)	ct.kind = Token::ShiftL;
 		else if ('=' == ch)	ct.kind = Token::LTE;
 		else {	unget();	ct.kind = Token::LT;	}
-		return ct;
+		break;
 
 	case '|':							// | or ||?
 		if (!getch(ch)) 	ct.kind = Token::BitOR;
 		else if ('|' == ch) ct.kind = Token::OR;
-		else {	unget();	ct.kind = Token::GT;	}
-		return ct;
+		else {	unget();	ct.kind = Token::BitOR;	}
+		break;
 
 	case '&':							// & or &&?
 		if (!getch(ch)) 	ct.kind = Token::BitAND;
 		else if ('&' == ch) ct.kind = Token::AND;
 		else {	unget();	ct.kind = Token::BitAND;  }
-		return ct;
+		break;
 
 	case '{':									// comment; { ... }
 		ct.integer_value = lineNum;				// remember where the comment stated...
-		do {									// eat everthhing up to the closing '}'
-			if (!getch(ch)) {
+		for (;;) {								// eat everthhing up to the closing '}'
+			cur = Scan::comment(cur, lim, lineNum);	// keep counting lines...
+			if (cur < lim)
+				break;
+
+			if (!refill()) {
+				prev = nullptr;
 				ct.kind = Token::BadComment;
 				return ct;
 			}
-
-			if ('\n' == ch)
-				++lineNum;						// keep counting lines...
-
-		} while ('}' != ch);
-		return get();							// restart the scan..
+		}
+		++cur;									// Consume the '}'
+		return scan();							// restart the scan..
 
 	case '%': case '(': case ')': case '*':
 	case '+': case ',': case '-': case '/':
 	case ':': case ';': case '^':
-		return ct = { static_cast<Token::Kind>(ch) };
+		ct = { static_cast<Token::Kind>(ch) };
+		break;
 
 	case '.': 									// real number, or just a '.'
-		ct.string_value = ch;
-		if (!getch(ch) || !isdigit(ch))
-			ct.kind = Token::Period;
-
-		else {									// Real...
-			ct.string_value = ch;
-			ct.kind = Token::RealNum;
-			while (getch(ch) && (isdigit(ch) || 'e' == ch || 'E' == ch))
-				ct.string_value += ch;
+		if (!getch(ch) || !isdigit(ch)) {
 			unget();
+			ct.kind = Token::Period;
 
-			std::istringstream iss (ct.string_value);
-			iss >> ct.real_value;
-			return ct;
-		}
-		return ct;
+		} else									// Real...
+			return number(start);
+		break;
 												// integer or real number
 	case '0': case '1': case '2': case '3': case '4':
-	case '5': case '6': case '7': case '8': case '9': {
-		ct.kind = Token::IntegerNum;			// Assume integer value...
-		ct.string_value = ch;
-		while (getch(ch)) {
-			if ('.' == ch || 'e' == ch || 'E' == ch)
-				ct.kind = Token::RealNum;
-
-			else if (!isdigit(ch))
-				break;
-
-			ct.string_value += ch;
-		}
-		unget();
-
-		std::istringstream iss (ct.string_value);
-		if (Token::RealNum == ct.kind)
-			iss >> ct.real_value;
-
-		else
-			iss >> ct.integer_value;
-		return ct;
-	}
+	case '5': case '6': case '7': case '8': case '9':
+		return number(start);
 
 	default:							// ident, ident = or error
 		if (isalpha(ch)) {
-			ct.string_value = ch;
-			while (getch(ch) && isalnum(ch))
-				ct.string_value += ch;
+			cur = Scan::ident(cur, lim);
 
-			unget();
-			auto it = keywords.find(ct.string_value);
-			if (keywords.end() != it)
-				ct.kind = it->second;
-			else
-				ct.kind = Token::Identifier;
+			ct.text = string_view(start, cur - start);
+			ct.kind = keyword(ct.text);
 			return ct;
 
 		} else {
-			ct.string_value = ch;
+			ct.text = string_view(start, 1);
 			ct.integer_value = ch;
 			ct.kind = Token::Unknown;
 			return ct;
 		}
 	}
+
+	ct.text = string_view(start, cur - start);	// Operators and punctuation
+	return ct;
+}
+
+/**
+ * Scans, and converts, an integer or real number, without copying it:
+ *
+ *     digits [ "." [ digits ] ] [ exponent ] | "." digits [ exponent ]
+ *     exponent = ( "e" | "E" ) [ "+" | "-" ] digits
+ *
+ * Numbers with a fraction, or an exponent, are real. Numbers that are out of range are replaced
+ * by the largest integer, or by an infinite, or zero, real, and flagged as overflowed.
+ *
+ * @param	start	The number's first character, a digit or "."
+ * @return	The number
+ */
+Token& TokenStream::number(const char* start) {
+	bool real = false;
+	bool negative = false;						// Negative exponent?
+
+	const char* p = Scan::digits(start, lim);
+	if (p < lim && '.' == *p) {
+		real = true;
+		p = Scan::digits(p + 1, lim);
+	}
+
+	if (p < lim && ('e' == *p || 'E' == *p)) {	// Only if the exponent is well formed
+		const char* q = p + 1;
+		if (q < lim && ('+' == *q || '-' == *q))
+			negative = '-' == *q++;
+
+		if (q < lim && isdigit(*q)) {
+			real = true;
+			p = Scan::digits(q, lim);
+		}
+	}
+
+	cur = p;
+	prev = nullptr;
+	ct.text = string_view(start, p - start);
+	ct.overflow = false;
+
+	if (real) {
+		ct.kind = Token::RealNum;
+		if (errc::result_out_of_range == from_chars(start, p, ct.real_value).ec) {
+			ct.overflow = true;
+			ct.real_value = negative ? 0 : numeric_limits<Datum::Real>::infinity();
+		}
+
+	} else {
+		ct.kind = Token::IntegerNum;
+		if (errc::result_out_of_range == from_chars(start, p, ct.integer_value).ec) {
+			ct.overflow = true;
+			ct.integer_value = numeric_limits<Datum::Integer>::max();
+		}
+	}
+
+	return ct;
+}
+
+/**
+ * Scans the input, publishing each token, along with its line number, to the ring, until the end
+ * of the input, or until asked to stop.
+ */
+void TokenStream::produce() {
+	for (;;) {
+		scan();
+		ct.line = lineNum;
+		while (!ring.push(ct)) {
+			if (stopping)
+				return;
+			this_thread::yield();
+		}
+
+		if (Token::EOS == ct.kind) {
+			done = true;
+			return;
+		}
+	}
+}
+
+/// Pop the next token from the ring into tok, waiting for the scanning thread if need be
+void TokenStream::consume() {
+	for (unsigned spins = 0; !ring.pop(tok); ++spins) {
+		if (done && !ring.pop(tok)) {		// Past EOS; keep returning it
+			tok = { Token::EOS };
+			tok.line = lineNum;
+			return;
+		}
+
+		if (spins > 64)
+			this_thread::yield();
+	}
 }
 
 // public static
@@ -200,6 +318,11 @@ string Token::toString(Token::Kind k) {
 	case Kind::Do:			return "do";			break;
 	case Kind::Repeat:		return "repeat";		break;
 	case Kind::Until:		return "until";			break;
+	case Kind::Case:		return "case";			break;
+	case Kind::Of:			return "of";			break;
+	case Kind::For:			return "for";			break;
+	case Kind::To:			return "to";			break;
+	case Kind::Step:		return "step";			break;
 
 	case Kind::Integer:		return "integer";		break;
 	case Kind::Real:		return "real";			break;
@@ -251,6 +374,38 @@ string Token::toString(Token::Kind k) {
 
 // public
 
+/**
+ * Returns the next token, from the scanning thread if pipelined, which is started on the first
+ * call. Identifiers are interned here, so that the interner is only ever used by this thread.
+ * @return	The next token
+ */
+Token TokenStream::get() {
+	if (!piped) {
+		scan();
+		ct.line = lineNum;
+		tok = ct;
+
+	} else {
+		if (!scanner.joinable() && !done) {
+			if (ip) {							// Read the rest of the stream, so tokens text is stable
+				contents.append(istreambuf_iterator<char>(*ip), istreambuf_iterator<char>());
+				if (owns) delete ip;
+				ip = nullptr;
+				owns = false;
+				text = contents;
+				cur = text.data();
+				lim = cur + text.size();
+			}
+			scanner = thread(&TokenStream::produce, this);
+		}
+		consume();
+	}
+
+	if (Token::Identifier == tok.kind)
+		tok.symbol = interner.intern(tok.text.data(), tok.text.size());
+	return tok;
+}
+
 /**
  * Set the input stream to a reference to s.
  * @param	s	The new input stream
@@ -262,6 +417,62 @@ void TokenStream::set_input(std::istream& s) {
 	lineNum = 1;
 }
 
+/**
+ * Scan buffer in place; buffer must outlive the scan.
+ * @param	buffer	The source text
+ */
+void TokenStream::set_input(string_view buffer) {
+	close();
+	text = buffer;
+	cur = text.data();
+	lim = cur + text.size();
+	lineNum = 1;
+}
+
+/**
+ * Map the named file, and scan it in place. Files that can't be mapped, e.g., empty files or
+ * pipes, are read into memory instead.
+ *
+ * @param	path	The source file name
+ * @return	false if the file couldn't be opened
+ */
+bool TokenStream::open(const string& path) {
+	close();
+	lineNum = 1;
+
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (0 == fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (MAP_FAILED != p) {
+			mapping = p;
+			mapSize = st.st_size;
+			madvise(mapping, mapSize, MADV_SEQUENTIAL);
+		}
+	}
+	::close(fd);
+
+	if (mapping)
+		text = string_view(static_cast<const char*>(mapping), mapSize);
+
+	else {
+		ifstream ifile(path, ios::binary);
+		if (!ifile.is_open())
+			return false;
+
+		contents.assign(istreambuf_iterator<char>(ifile), istreambuf_iterator<char>());
+		text = contents;
+	}
+
+	cur = text.data();
+	lim = cur + text.size();
+
+	return true;
+}
+
 /**
  * Set th input stream to p, taking ownership of that stream.
  * @param	p	The new input stream
@@ -273,9 +484,24 @@ void TokenStream::set_input(std::istream* p) {
 	lineNum = 1;
 }
 
+/**
+ * The whole of a file or buffer, but only the lines kept so far from an input stream.
+ * @return	The source
+ */
+string_view TokenStream::source() const {
+	return ip ? string_view(contents) : text;
+}
+
 // privite static
 
-TokenStream::KeywordTable	TokenStream::keywords = {
+/// A keyword, and it's kind
+struct Keyword {
+	string_view		name;					///< The keyword
+	Token::Kind		kind;					///< It's kind
+};
+
+/// The keywords
+static constexpr Keyword keywords[] = {
 	{   "const",		Token::ConsDecl		},
 	{	"var",			Token::VarDecl		},
 	{	"procedure",	Token::ProcDecl		},
@@ -289,8 +515,49 @@ TokenStream::KeywordTable	TokenStream::keywords = {
 	{	"do",			Token::Do			},
 	{	"repeat",		Token::Repeat		},
 	{	"until",		Token::Until		},
+	{	"case",			Token::Case			},
+	{	"of",			Token::Of			},
+	{	"for",			Token::For			},
+	{	"to",			Token::To			},
+	{	"step",			Token::Step			},
 	{	"mod",			Token::Mod			},
 	{	"integer",		Token::Integer		},
 	{	"real",			Token::Real			},
 	{	"round",		Token::Round		}
 };
+
+static constexpr size_t nKeywordSlots = 64;	///< Size of the keyword hash table
+
+/**
+ * A perfect hash of the keywords, from their first and last characters, and length.
+ * @param	s	The spelling to hash; not empty
+ * @return	s's slot in keywordTable
+ */
+static constexpr size_t keywordHash(string_view s) {
+	return (s.front() + 5 * s.back() + s.size()) % nKeywordSlots;
+}
+
+/// @return The keywords, indexed by their hash. Fails to compile if the hash isn't perfect
+static constexpr array<Keyword, nKeywordSlots> hashKeywords() {
+	array<Keyword, nKeywordSlots> table {};
+
+	for (const auto& k : keywords) {
+		auto& slot = table[keywordHash(k.name)];
+		if (!slot.name.empty())
+			throw "keyword hash collision";
+		slot = k;
+	}
+
+	return table;
+}
+
+static constexpr auto keywordTable = hashKeywords();	///< The keyword hash table
+
+/**
+ * @param	s	An identifier, or keyword
+ * @return	s's keyword kind, or Identifier
+ */
+Token::Kind TokenStream::keyword(string_view s) {
+	const Keyword& k = keywordTable[keywordHash(s)];
+	return k.name == s ? k.kind : Token::Identifier;
+}
@@ -14,10 +14,15 @@
 #define TOKEN_H
 
 #include "datum.h"
+#include "intern.h"
+#include "ring.h"
 
-#include <map>
+#include <cstdint>
+#include <initializer_list>
+#include <atomic>
 #include <sstream>
-#include <set>
+#include <string_view>
+#include <thread>
 
 /// A token "kind"/value pair
 struct Token {
@@ -31,7 +36,7 @@ struct Token {
 		Unknown,						///< Unknown token kind; (integer_value)
 		BadComment,						///< Unterminated comment, started at line # (integer_value)
 
-		Identifier,	  		  			///< An identifier (string_value)
+		Identifier,	  		  			///< An identifier (symbol)
 		IntegerNum,						///< Integer literal number (integer_value)
 		RealNum,						///< Real literal number (real_value)
 		ConsDecl,						///< "const" constant declaration
@@ -47,6 +52,11 @@ struct Token {
 		Do,								///< "do"
 		Repeat,							///< "repeat" ... "until"
 		Until,							///< "until"
+		Case,							///< "case" expr "of" ...
+		Of,								///< "of"
+		For,							///< "for" ident "=" expr "to" expr ...
+		To,								///< "to"
+		Step,							///< "step"
 
 		Integer,						///< "integer"
 		Real,							///< "real
@@ -91,18 +101,39 @@ struct Token {
 		Assign		= '='				///< Assignment
 	};
 
-	/// A set of Token kinds
-	typedef std::set<Kind>	KindSet;
+	/// A set of Token kinds; a bit per kind, so sets may be constants
+	class KindSet {
+	public:
+		/// Construct a set of kinds
+		constexpr KindSet(std::initializer_list<Kind> kinds) : bits{} {
+			for (auto k : kinds)
+				bits[index(k) / 64] |= std::uint64_t{1} << index(k) % 64;
+		}
+
+		/// Is k a member of the set?
+		constexpr bool contains(Kind k) const {
+			return bits[index(k) / 64] >> index(k) % 64 & 1;
+		}
+
+	private:
+		std::uint64_t	bits[4];		///< A bit per kind
+
+		/// k's bit number
+		static constexpr unsigned index(Kind k)	{	return static_cast<unsigned char>(k);	}
+	};
 
 	static std::string toString(Kind k); ///< Return k's name
 
 	Kind			kind;				///< Token type
-	std::string		string_value;		///< kind == Identifier
+	Interner::Id	symbol;				///< kind == Identifier
+	std::string_view text;				///< The token's spelling, valid until the next token
 	Datum::Integer	integer_value;      ///< Kind == IntegerNum
 	Datum::Real		real_value;			///< Kind == RealNum
+	bool			overflow;			///< Kind == IntegerNum or RealNum, and out of range
+	std::size_t		line;				///< The stream's line # after the token was scanned
 
-	/// Construct a token of type k, stirng value "", number value 0.
-	Token(Kind k) : kind{k}, integer_value{0} {}
+	/// Construct a token of type k, empty text, number value 0.
+	Token(Kind k = EOS) : kind{k}, symbol{0}, integer_value{0}, real_value{0}, overflow{false}, line{0} {}
 	virtual ~Token() {}					///< Destructor
 };
 
@@ -112,49 +143,91 @@ struct Token {
  *
  *	Token streams may span multiple inputs; when the end of one input is seen,
  *	the current Token is equal to end of stream (Kind::end), a new input source
- *	maybe set via set_input(); get() will return the first Token of the new
+ *	maybe set via set_input(), or open(); get() will return the first Token of the new
  *	input.
+ *
+ *	Input streams are read a line at a time, but files are mapped, and buffers are scanned, in
+ *	place; token text refers directly to the line, mapping or buffer, so nothing is copied.
+ *	The source remains available, e.g., for a listing, until the next input is set; lines read
+ *	from an input stream are only kept if requested.
+ *
+ *	If pipelined, the input is scanned by a separate thread, that publishes tokens via a lock-free
+ *	ring that get() consumes; the whole of an input stream is read first. Each token carries the
+ *	line number it was scanned at. Identifiers are always interned by the consumer, so names()
+ *	is only used by one thread.
  */
 class TokenStream {
 public:
 	size_t			lineNum;			///< Line # of the current stream
 
 	/// Initialize with an input stream which this does not own
-	TokenStream(std::istream& s) : lineNum{1}, ip{&s}, owns{false}, col{0}	{}
+	TokenStream(std::istream& s)		{	set_input(s);	}
 
 	/// Initialize with an input stream which this does own
-	TokenStream(std::istream* s) : lineNum{1}, ip{s}, owns{true}, col{0}	{}
+	TokenStream(std::istream* s)		{	set_input(s);	}
 
 	/// Destructor
 	virtual ~TokenStream()				{	close();	}
 
-	/// Return the next character from the stream. Sets eof in *ip and return *ip
-	std::istream& getch(char& c);
-	std::istream& unget();				///< Return last character to the stream
+	/// Return the next character from the input in c. Returns false at the end of the input
+	bool getch(char& c);
+	void unget();						///< Return last character to the input
 
-	Token get();
+	Token get();						///< Read and return the next token
 
 	/// The current token
-	Token& current() 					{	return ct;	}
+	Token& current() 					{	return tok;	}
+
+	/// The identifiers interned so far
+	Interner& names()					{	return interner;	}
 
 	void set_input(std::istream& s);	///< Set the input stream to s
 	void set_input(std::istream* p);	///< Set the input stream to p
+	void set_input(std::string_view buffer);	///< Scan buffer, which this does not own
+	bool open(const std::string& path);	///< Map, or read, the named file
 
-private:								/// A map of keywords to their 'kind'
-	typedef	std::map<std::string, Token::Kind> KeywordTable;
+	/// Keep the lines read from input streams, if k is true
+	void keep(bool k)					{	keeping = k;	}
 
-	static	KeywordTable	keywords;	///< The keyword table
+	/// Scan the next input on a separate thread, if p is true
+	void pipeline(bool p)				{	piped = p;		}
 
-	std::istream*	ip;					///< Pointer to an input stream
-	bool			owns;				///< Does *this* own ip?
-	size_t 			col;				///< Index into line for next character
-	std::string 	line;				///< last line read from the stream
+	std::string_view source() const;	///< The source scanned so far
 
-	/// The current token
-	Token 			ct { Token::Kind::EOS };
+private:
+	/// Return the keyword spelt s's kind, or Identifier if s isn't a keyword
+	static Token::Kind keyword(std::string_view s);
 
-	/// If *this* owns ip, delete it.
-	void close()							{ if (owns) delete ip;	}
+	static const std::size_t ringSize = 1024;	///< Size of the pipeline's ring, in tokens
+
+	std::istream*	ip = nullptr;		///< Pointer to an input stream, or nullptr
+	bool			owns = false;		///< Does *this* own ip?
+	std::string 	line;				///< last line read from the stream
+	const char*		cur = nullptr;		///< Next character in the line, mapping or buffer
+	const char*		lim = nullptr;		///< End of the line, mapping or buffer
+	const char*		prev = nullptr;		///< The last character read, if it may be returned
+	void*			mapping = nullptr;	///< The mapped file, if any
+	std::size_t		mapSize = 0;		///< The mapping's size
+	std::string_view text;				///< The mapping, or buffer
+	std::string		contents;			///< A file that couldn't be mapped, or the kept lines
+	bool			keeping = false;	///< Keep lines read from input streams?
+	Interner		interner;			///< Identifier symbols
+
+	Token 			ct;					///< The token being scanned
+	Token			tok;				///< The current token
+
+	bool			piped = false;		///< Scan on a separate thread?
+	std::thread		scanner;			///< The scanning thread, if running
+	std::atomic<bool> stopping {false};	///< Should the scanning thread stop?
+	std::atomic<bool> done {false};		///< Has the scanning thread published EOS?
+	Ring<Token, ringSize> ring;			///< Tokens published by the scanning thread
+
+	Token& scan();						///< Scan the next token into ct
+	Token& number(const char* start);	///< Scan a number starting at start
+	void produce();						///< The scanning thread
+	void consume();						///< Pop the next token into tok
+	bool refill();						///< Read the next line from the input stream
+	void close();						///< Release the current input
 };
 
 #endif
@@ -0,0 +1,27 @@
+{ Counted loops are unrolled, by four, with the original loop	}
+{ running the remaining iterations, at -O2						}
+var sum, n, i : integer;
+
+{ i counts up from the smallest integer to a variable limit }
+procedure fromMin(m : integer)
+	begin
+		i = -2147483647 - 1;
+		while i < m do begin
+			n = n + 1;
+			i = i + 1
+		end
+	end;
+
+begin
+	n = 10;
+	sum = 0;
+	i = 0;
+	while i < n do begin
+		sum = sum + i * i;
+		i = i + 1
+	end;
+
+	n = 0;
+	fromMin(-2147483647);				{ limit - 3 would overflow; s/b 1	}
+	fromMin(-2147483640)				{ s/b 9								}
+end.
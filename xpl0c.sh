@@ -1,10 +1,24 @@
 #!/bin/bash
-for i in $( ls *.p ); do
-	./pl0c $i &> $i.lst
-	cmp $i.lst test/$i.lst
+# Run each test program, compare the results with those in test/; first as is, then at -O2, and
+# then both again via the AST
+check() {
+	cmp $1 test/$1
 	if [ "$?" != "0" ]; then
-		diff $i.lst test/$i.lst
-		exit
+		diff $1 test/$1
+		exit 1
 	fi
-done
+}
 
+for i in $( ls *.p ); do
+	./pl0c $i &> $i.lst
+	check $i.lst
+
+	./pl0c -O2 $i &> $i.O2.lst
+	check $i.O2.lst
+
+	./pl0c -ast $i &> $i.lst
+	check $i.lst
+
+	./pl0c -ast -O2 $i &> $i.O2.lst
+	check $i.O2.lst
+done